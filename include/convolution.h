@@ -3,21 +3,275 @@
 
 #include <stdint.h>
 
-// Image structure
+// Pixel sample types
+typedef enum {
+    PIXEL_U8,
+    PIXEL_U16,
+    PIXEL_F32,
+    PIXEL_F16               // half precision, used for intermediate buffers only
+} PixelType;
+
+// Image structure; data holds width*height*channels samples of the given type
 typedef struct {
     int width;
     int height;
     int channels;
+    PixelType type;
     uint8_t *data;
 } Image;
 
+#define IMAGE_U16(img) ((uint16_t*)(img)->data)
+#define IMAGE_F32(img) ((float*)(img)->data)
+
+// Floating-point image used for intermediate (and signed) results
+typedef struct {
+    int width;
+    int height;
+    int channels;
+    float *data;
+} FloatImage;
+
+// Laplacian pyramid: level[0..levels-2] are band-pass, level[levels-1] is the low-pass residual
+typedef struct {
+    int levels;
+    FloatImage** level;
+} LaplacianPyramid;
+
+// Resampling filters for resize
+typedef enum {
+    RESIZE_LANCZOS3,
+    RESIZE_BICUBIC,
+    RESIZE_AREA
+} ResizeFilter;
+
+// 1-D Gaussian prepared for one quantized sigma level
+typedef struct {
+    float sigma;
+    int radius;
+    float* taps;             // 2*radius+1 normalized taps
+} PreparedKernel;
+
+// Prepared kernels indexed by quantized level
+typedef struct {
+    int levels;
+    float max_sigma;
+    PreparedKernel* kernel;
+} KernelCache;
+
+// Work counters reported by the spatially varying engine
+typedef struct {
+    int tiles;
+    int kernels_used;
+    long tile_passes;        // (tile, kernel) blur passes actually run
+    long steals;             // tiles stolen under -s steal
+} VaryingStats;
+
+// Receives each scale-space level: is_dog = 0 for Gaussian i, 1 for DoG i (level i+1 - level i)
+typedef void (*ScaleSpaceEmit)(int is_dog, int index, float sigma, Image* img, void* user);
+
+// Cost summary of a scale-space build
+typedef struct {
+    double blur_time;
+    long incremental_taps;   // separable taps per pixel actually applied
+    long independent_taps;   // taps per pixel if each level blurred the input directly
+} ScaleSpaceStats;
+
+// Stack of equally sized slices (z-stacks, frame sequences)
+typedef struct {
+    int width;
+    int height;
+    int depth;
+    int channels;
+    PixelType type;
+    Image** slice;           // depth images of width x height
+} Volume;
+
+// Last N frames of a sequence in preallocated images, for streaming temporal filters
+typedef struct {
+    int capacity;            // N
+    int count;               // frames held so far (<= N)
+    int head;                // slot of the newest frame
+    float* weights;          // weights[i] applies to the frame i steps before the newest
+    Image** frame;
+} FrameRing;
+
+// Read-only copies of an image, one per NUMA node
+typedef struct {
+    int nodes;
+    Image** copy;            // copy[n] has its pages on node n
+} ImageReplicas;
+
+// Task body for the work-stealing scheduler
+typedef void (*StealTaskFn)(int task, int thread, void* arg);
+
+// Work-stealing counters
+typedef struct {
+    int tasks;
+    long steals;             // tasks run by a thread other than the one seeded with them
+} StealStats;
+
+// Largest team the adaptive scheduler keeps weights for
+#define ADAPTIVE_MAX_THREADS 256
+
+// Per-thread throughput learned by the adaptive scheduler, carried from image to image
+typedef struct {
+    int threads;             // team size the weights were measured with (0 before the first run)
+    int runs;
+    double weight[ADAPTIVE_MAX_THREADS];  // relative tasks per second, mean 1
+} ThreadWeights;
+
+// Adaptive scheduler counters
+typedef struct {
+    int tasks;
+    int rounds;              // repartitions of the remaining tasks
+} AdaptiveStats;
+
+// Problem an autotuned configuration applies to
+typedef struct {
+    int width;
+    int height;
+    int channels;
+    PixelType type;
+    int kernel_size;
+    char cpu[128];           // CPU model name
+} TuneKey;
+
+// Options set by a wisdom entry, as a mask of those given on the command line
+#define TUNE_THREADS  0x01
+#define TUNE_SCHEDULE 0x02
+#define TUNE_CHUNK    0x04
+#define TUNE_TILE     0x08
+#define TUNE_ORDER    0x10
+
+// How a multi-stage job is scheduled
+typedef enum {
+    EXEC_PERSISTENT,         // one parallel region, per-band progress flags
+    EXEC_REGIONS,            // one parallel region per stage (fork/join)
+    EXEC_TASKS,              // one task per (stage, band) with depend clauses
+    EXEC_STREAM              // row-order streaming through per-stage line buffers
+} ExecModel;
+
+// Execution context for multi-stage jobs
+typedef struct {
+    int num_threads;
+    int band_rows;           // rows per band (0 for the default)
+    ExecModel model;
+} ExecContext;
+
+typedef enum {
+    STAGE_GAUSSIAN,
+    STAGE_BOX,
+    STAGE_SOBEL,
+    STAGE_THRESHOLD
+} StageType;
+
+// One row-local pipeline stage
+typedef struct {
+    StageType type;
+    int radius;              // rows of context needed above and below
+    float param;             // threshold level
+    float* taps;             // gaussian/box taps (2 * radius + 1)
+} PipelineStage;
+
+typedef struct {
+    int count;
+    PipelineStage* stage;
+} Pipeline;
+
+// Timing summary of a pipeline run
+typedef struct {
+    double elapsed;
+    int regions;             // parallel regions forked
+    int bands;
+    int tasks;               // tasks created (EXEC_TASKS only)
+    long buffer_bytes;       // intermediate storage: line buffers per thread (EXEC_STREAM) or images
+} PipelineStats;
+
+// One non-zero tap of a sparse kernel
+typedef struct {
+    int dy, dx;              // offset from the output pixel (dilation applied)
+    float w;
+} SparseTap;
+
+// Non-zero taps only, sorted by (dy, dx) so taps on the same source row are adjacent
+typedef struct {
+    int count;
+    int radius;              // largest |dy| or |dx|
+    int dilation;
+    SparseTap* taps;
+} SparseKernel;
+
+// Receives a trous planes: index < levels is detail plane index, index == levels the residual
+typedef void (*AtrousEmit)(int index, Image* img, void* user);
+
+// Cost summary of an a trous transform
+typedef struct {
+    double convolve_time;
+    long sparse_taps;        // taps per pixel applied over all scales
+    long dense_taps;         // taps per pixel of dense kernels with the same extents
+} AtrousStats;
+
+// Point spread function prepared for deconvolution
+typedef struct {
+    int size;
+    float** kernel;          // PSF as given (correlating with it applies the adjoint)
+    float** flipped;         // PSF rotated 180 degrees (correlating with it applies the blur)
+    int separable;           // 1 if the PSF is rank-1 within tolerance
+    float* col_taps;         // vertical factor (separable PSFs); owns all four tap arrays
+    float* row_taps;         // horizontal factor
+    float* col_flipped;
+    float* row_flipped;
+} PreparedPSF;
+
+// Timing summary of a deconvolution run
+typedef struct {
+    int iterations;
+    double total_time;
+    double time_per_iteration;
+} DeconvStats;
+
+// Shape of an iterated (temporally blocked) convolution
+typedef struct {
+    int iterations;
+    int time_block;          // steps advanced per tile per sweep
+    int sweeps;              // passes over the image in memory
+    int tiles;
+    int tile_w;
+    int tile_h;
+} IterateStats;
+
+// Throughput summary of a batch run
+typedef struct {
+    int images;              // images convolved and saved
+    int failed;
+    int in_flight;           // outer team size
+    int threads_per_image;   // nested team size
+    long pixels;
+    double elapsed;
+    ThreadWeights* weights;  // -s adaptive: per outer thread, owned by the caller (else NULL)
+} BatchStats;
+
+// How -t auto chose the team size
+typedef struct {
+    int cpus;                // usable CPUs: affinity mask capped by the cgroup quota
+    int quota;               // cgroup CPU quota in CPUs, 0 if none
+    long work;               // multiply-adds per image (pixels x taps x channels)
+    double work_time;        // estimated single-thread time for that work
+    double fork_join;        // measured fork/join cost of the chosen team
+    double predicted;        // model time with the chosen team
+} AutoThreadStats;
+
 // Convolution configuration
 typedef struct {
     int num_threads;
-    char schedule_type[16];  // "static", "dynamic", "guided"
+    char schedule_type[16];  // "static", "dynamic", "guided", "steal", "adaptive"
     int chunk_size;
-    int tile_size;           // 0 for no tiling, 8 for 8x8, 16 for 16x16
+    int tile_size;           // tile rows, and columns unless tile_width is set; 0 for no tiling
+    int tile_width;          // tile columns for rectangular tiles, 0 for square tiles
     int loop_order;          // 0 for Y-first, 1 for X-first
+    int half_intermediates;  // 1 to keep multi-pass intermediates in FP16
+    char affinity[64];       // "none", "compact", "scatter", "core" or a CPU list like "0,2,4-7"
+    ThreadWeights* weights;  // learned by -s adaptive and reused by later runs, NULL to start equal
 } ConvConfig;
 
 // Function prototypes
@@ -26,15 +280,164 @@ int save_image(const char* filename, Image* img);
 void free_image(Image* img);
 
 Image* create_image(int width, int height, int channels);
+Image* create_image_typed(int width, int height, int channels, PixelType type);
+Image* convert_image(Image* src, PixelType type);
+int pixel_size(PixelType type);
+int parse_pixel_type(const char* name);
+const char* pixel_type_name(PixelType type);
+FloatImage* create_float_image(int width, int height, int channels);
+void free_float_image(FloatImage* img);
+FloatImage* image_to_float(Image* img);
+void float_to_image(FloatImage* src, Image* dst);
+void load_row_float(const Image* img, long offset, float* dst, long n);
+void store_row_float(const float* src, Image* img, long offset, long n);
+void store_row_truncate(const float* src, Image* img, long offset, long n);
+void accumulate_row(float* acc, const Image* img, long offset, float weight, long n);
+long transpose_row_stride(long row_bytes);
+void transpose_pixels(const uint8_t* src, long src_stride, uint8_t* dst, long dst_stride, int width, int height,
+                      int bytes, int num_threads);
+int transpose_image(const Image* src, Image* dst, int num_threads);
+
+// Half-precision conversion (F16C when available)
+void float_to_half_row(const float* src, uint16_t* dst, long n);
+void half_to_float_row(const uint16_t* src, float* dst, long n);
+void accumulate_half_row(float* acc, const uint16_t* src, float weight, long n);
 float** create_kernel(int size);
 void free_kernel(float** kernel, int size);
 float** create_gaussian_kernel(int size, float sigma);
 float** create_box_kernel(int size);
+float** create_ring_kernel(int size);
+float** create_line_kernel(int size, float angle);
+float* create_gaussian_taps(int size, float sigma);
+float* create_box_taps(int size);
 
 // Convolution functions
-void convolve_openmp(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config);
-void convolve_openmp_tiled(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config);
+int convolve_openmp(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config);
+int convolve_openmp_tiled(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config);
+void convolve_openmp_recursive(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config);
+int convolve_direct(Image* input, Image* output, float** kernel, int kernel_size, int recursive,
+                    ImageReplicas* replicas, ConvConfig* config);
 void convolve_sequential(Image* input, Image* output, float** kernel, int kernel_size);
+void convolve_separable(Image* input, Image* output, const float* taps, int kernel_size, ConvConfig* config);
+void convolve_separable_scratch(Image* input, Image* output, const float* taps, int kernel_size,
+                                ConvConfig* config, Image* tmp);
+void convolve_separable_xy(Image* input, Image* output, const float* row_taps, const float* col_taps,
+                           int kernel_size, ConvConfig* config, Image* tmp);
+
+// Volume functions
+Volume* create_volume(int width, int height, int depth, int channels, PixelType type);
+void free_volume(Volume* vol);
+char** read_path_list(const char* list_file, int* count);
+void free_path_list(char** paths, int count);
+Volume* load_volume(const char* list_file);
+int save_volume(const char* output_file, Volume* vol);
+int convolve_volume_separable(Volume* input, Volume* output, const float* taps, int kernel_size,
+                               ConvConfig* config);
+
+// Temporal filter functions
+FrameRing* create_frame_ring(int frames, int width, int height, int channels, PixelType type,
+                             const float* weights);
+void free_frame_ring(FrameRing* ring);
+void frame_ring_push(FrameRing* ring, Image* frame);
+void filter_spatiotemporal(FrameRing* ring, Image* output, const float* taps, int kernel_size,
+                           ConvConfig* config);
+
+// Work-stealing scheduler
+int steal_for(int num_tasks, ConvConfig* config, StealTaskFn fn, void* arg, StealStats* stats);
+
+// Adaptive throughput-feedback scheduler
+void adaptive_for(int num_tasks, ConvConfig* config, StealTaskFn fn, void* arg, AdaptiveStats* stats);
+
+// Cache-aware tiling functions
+long cache_size(int level);
+void choose_tile_shape(int width, int height, int channels, PixelType type, int kernel_size, int num_threads,
+                       int* tile_w, int* tile_h);
+
+// Autotuning functions
+void make_tune_key(TuneKey* key, Image* input, int kernel_size);
+const char* default_wisdom_path(void);
+int load_wisdom(const char* path, const TuneKey* key, ConvConfig* tuned);
+int save_wisdom(const char* path, const TuneKey* key, const ConvConfig* tuned, double seconds);
+void apply_wisdom(const ConvConfig* tuned, ConvConfig* config, unsigned given);
+double autotune_direct(Image* input, float** kernel, int kernel_size, const ConvConfig* base, ConvConfig* tuned);
+
+// Thread affinity functions
+int parse_cpu_list(const char* list, int* cpus, int max);
+int affinity_cpu_order(const char* policy, int* cpus, int max);
+int apply_affinity(ConvConfig* config);
+int affinity_bind(void);
+
+// NUMA placement functions
+int numa_node_count(void);
+int numa_current_node(void);
+Image* create_image_first_touch(int width, int height, int channels, PixelType type, ConvConfig* config);
+Image* copy_image_first_touch(Image* src, ConvConfig* config);
+ImageReplicas* replicate_image(Image* src, ConvConfig* config);
+void free_image_replicas(ImageReplicas* r);
+int convolve_openmp_replicated(ImageReplicas* input, Image* output, float** kernel, int kernel_size,
+                               ConvConfig* config);
+void report_page_placement(const char* label, Image* img);
+
+// Pipeline functions
+Pipeline* parse_pipeline(const char* spec);
+void free_pipeline(Pipeline* p);
+const char* stage_name(const PipelineStage* st);
+void pipeline_stage_row(const PipelineStage* st, const Image* in, int y, float range, float* out,
+                        float* scratch);
+int run_pipeline(ExecContext* ctx, Pipeline* p, Image* input, Image* output, PipelineStats* stats);
+
+// Iterated convolution functions
+int choose_time_block(int tile_w, int tile_h, int kernel_size, int iterations);
+int convolve_iterated(Image* input, Image* output, float** kernel, int kernel_size, int iterations, int time_block,
+                      ConvConfig* config, IterateStats* stats);
+
+// Thread count selection
+int available_cpus(int* quota);
+int choose_thread_count(Image* input, float** kernel, int kernel_size, const ConvConfig* config, int cpus,
+                        AutoThreadStats* stats);
+
+// Batch functions
+void choose_batch_split(int width, int height, int channels, PixelType type, int kernel_size, int num_threads,
+                        int count, int* images, int* threads_per_image);
+int convolve_batch(char** in_paths, char** out_paths, int count, int type, float** kernel, int kernel_size,
+                   int images, ConvConfig* config, BatchStats* stats);
+
+// Sparse kernel functions
+SparseKernel* create_sparse_kernel(float** kernel, int size, int dilation);
+void free_sparse_kernel(SparseKernel* k);
+int convolve_sparse(Image* input, Image* output, SparseKernel* k, ConvConfig* config);
+int atrous_transform(Image* input, Image* output, int levels, float gain, ConvConfig* config,
+                     AtrousEmit emit, void* user, AtrousStats* stats);
+
+// Pyramid functions
+FloatImage* pyramid_reduce(FloatImage* src, ConvConfig* config);
+LaplacianPyramid* laplacian_decompose(Image* input, int levels, ConvConfig* config);
+int laplacian_reconstruct(LaplacianPyramid* pyr, Image* output, ConvConfig* config);
+void laplacian_scale_details(LaplacianPyramid* pyr, float gain, ConvConfig* config);
+void free_laplacian_pyramid(LaplacianPyramid* pyr);
+
+// Spatially varying blur functions
+KernelCache* create_kernel_cache(int levels, float max_sigma);
+PreparedKernel* kernel_cache_get(KernelCache* cache, int level);
+void free_kernel_cache(KernelCache* cache);
+Image* create_vignette_map(int width, int height);
+void convolve_varying(Image* input, Image* output, Image* sigma_map, float max_sigma, int levels,
+                      ConvConfig* config, VaryingStats* stats);
+
+// Scale-space functions
+int build_scale_space(Image* input, int levels, float sigma0, float ratio, ConvConfig* config,
+                      ScaleSpaceEmit emit, void* user, ScaleSpaceStats* stats);
+
+// Deconvolution functions
+float** load_psf(const char* filename, int* size);
+PreparedPSF* prepare_psf(float** kernel, int size);
+void free_prepared_psf(PreparedPSF* psf);
+int deconvolve_richardson_lucy(Image* input, Image* output, PreparedPSF* psf, int iterations,
+                               ConvConfig* config, DeconvStats* stats);
+
+// Resize functions
+int parse_resize_filter(const char* name);
+int resize_image(Image* input, Image* output, ResizeFilter filter, float blur_sigma, ConvConfig* config);
 
 // Utility functions
 double get_time();
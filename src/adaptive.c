@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Rounds end once fewer than this many tasks per thread remain; the rest is one round
+#define ADAPTIVE_MIN_TASKS_PER_THREAD 4
+
+// Lower bound on a thread's weight, so a thread slowed down once still gets enough
+// work to be measured again and can win its share back
+#define ADAPTIVE_MIN_WEIGHT 0.05
+
+// Share of a new measurement in the running weight (the rest is the previous weight)
+#define ADAPTIVE_BLEND 0.5
+
+// Run fn(task, thread, arg) for tasks 0..num_tasks-1 on config->num_threads threads,
+// with each thread's share proportional to its measured throughput.
+//
+// The tasks run in rounds. Each round takes half of the remaining tasks (all of them
+// once fewer than ADAPTIVE_MIN_TASKS_PER_THREAD per thread remain) and splits that
+// block into contiguous ranges, thread i getting the i-th range sized by its weight,
+// as schedule(static) would with equal weights. Each thread times its range. Between
+// rounds the weights move towards the measured tasks per second, normalized to a mean
+// of 1, so the next, smaller round corrects any imbalance left by the previous one.
+//
+// config->weights, if set, holds the weights learned so far for this team size. They
+// seed the first round and receive the final weights, so later images of a batch
+// start out balanced for the threads' actual speeds.
+void adaptive_for(int num_tasks, ConvConfig* config, StealTaskFn fn, void* arg, AdaptiveStats* stats) {
+    int rounds = 0;
+    double weight[ADAPTIVE_MAX_THREADS];
+    double elapsed[ADAPTIVE_MAX_THREADS];
+    int begin[ADAPTIVE_MAX_THREADS + 1];
+    int lo = 0;
+    int nthreads = 1;
+
+    omp_set_num_threads(config->num_threads < ADAPTIVE_MAX_THREADS ? config->num_threads : ADAPTIVE_MAX_THREADS);
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        affinity_bind();
+
+        #pragma omp single
+        {
+            nthreads = omp_get_num_threads();
+            ThreadWeights* learned = config->weights;
+            for (int i = 0; i < nthreads; i++) {
+                weight[i] = learned && learned->threads == nthreads ? learned->weight[i] : 1.0;
+            }
+        }
+
+        while (lo < num_tasks) {
+            #pragma omp single
+            {
+                int remaining = num_tasks - lo;
+                int size = remaining < 2 * ADAPTIVE_MIN_TASKS_PER_THREAD * nthreads ? remaining : remaining / 2;
+                double total = 0.0;
+                for (int i = 0; i < nthreads; i++) total += weight[i];
+
+                double acc = 0.0;
+                for (int i = 0; i < nthreads; i++) {
+                    begin[i] = lo + (int)(size * acc / total + 0.5);
+                    acc += weight[i];
+                }
+                begin[nthreads] = lo + size;
+                rounds++;
+            }
+
+            double start = omp_get_wtime();
+            for (int k = begin[tid]; k < begin[tid + 1]; k++) {
+                fn(k, tid, arg);
+            }
+            elapsed[tid] = omp_get_wtime() - start;
+
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                // Tasks per second of the threads that ran anything this round
+                double rate[ADAPTIVE_MAX_THREADS];
+                double rate_sum = 0.0;
+                double weight_sum = 0.0;
+                for (int i = 0; i < nthreads; i++) {
+                    int count = begin[i + 1] - begin[i];
+                    rate[i] = count > 0 && elapsed[i] > 0.0 ? count / elapsed[i] : 0.0;
+                    if (rate[i] > 0.0) {
+                        rate_sum += rate[i];
+                        weight_sum += weight[i];
+                    }
+                }
+
+                // Rates rescaled to the measured threads' total weight, blended in, renormalized
+                if (rate_sum > 0.0) {
+                    double mean = 0.0;
+                    for (int i = 0; i < nthreads; i++) {
+                        if (rate[i] > 0.0) {
+                            weight[i] = (1.0 - ADAPTIVE_BLEND) * weight[i] +
+                                        ADAPTIVE_BLEND * rate[i] * weight_sum / rate_sum;
+                        }
+                        mean += weight[i];
+                    }
+                    mean /= nthreads;
+                    for (int i = 0; i < nthreads; i++) {
+                        weight[i] /= mean;
+                        if (weight[i] < ADAPTIVE_MIN_WEIGHT) weight[i] = ADAPTIVE_MIN_WEIGHT;
+                    }
+                }
+                lo = begin[nthreads];
+            }
+        }
+    }
+
+    if (config->weights) {
+        ThreadWeights* learned = config->weights;
+        learned->threads = nthreads;
+        learned->runs++;
+        memcpy(learned->weight, weight, nthreads * sizeof(double));
+    }
+    if (stats) {
+        stats->tasks = num_tasks;
+        stats->rounds = rounds;
+    }
+}
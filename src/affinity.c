@@ -0,0 +1,207 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sched.h>
+#include <omp.h>
+#include "convolution.h"
+
+#define AFFINITY_MAX_CPUS 1024
+
+// One logical CPU with its position in the package/core/SMT hierarchy
+typedef struct {
+    int cpu;
+    int package;
+    int core;
+    int smt;                 // index among the core's hyperthreads
+} CpuInfo;
+
+static int read_int_file(const char* path, int fallback) {
+    FILE* f = fopen(path, "r");
+    int value = fallback;
+    if (f) {
+        if (fscanf(f, "%d", &value) != 1) value = fallback;
+        fclose(f);
+    }
+    return value;
+}
+
+// Logical CPUs this process may run on, with topology from sysfs
+static int load_topology(CpuInfo* cpus, int max) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return 0;
+
+    int count = 0;
+    for (int c = 0; c < CPU_SETSIZE && c < AFFINITY_MAX_CPUS && count < max; c++) {
+        if (!CPU_ISSET(c, &allowed)) continue;
+
+        char path[128];
+        CpuInfo* info = &cpus[count];
+        info->cpu = c;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+        info->package = read_int_file(path, 0);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", c);
+        info->core = read_int_file(path, c);
+
+        // SMT index: earlier allowed CPUs on the same core
+        info->smt = 0;
+        for (int i = 0; i < count; i++) {
+            if (cpus[i].package == info->package && cpus[i].core == info->core) info->smt++;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Compact: siblings adjacent, then cores, then packages
+static int compare_compact(const void* a, const void* b) {
+    const CpuInfo* x = (const CpuInfo*)a;
+    const CpuInfo* y = (const CpuInfo*)b;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->smt - y->smt;
+}
+
+// Scatter: alternate packages first, then cores; hyperthreads come last
+static int compare_scatter(const void* a, const void* b) {
+    const CpuInfo* x = (const CpuInfo*)a;
+    const CpuInfo* y = (const CpuInfo*)b;
+    if (x->smt != y->smt) return x->smt - y->smt;
+    if (x->core != y->core) return x->core - y->core;
+    return x->package - y->package;
+}
+
+// Parse "0,2,4-7" into cpus; returns the count, or -1 on a syntax error
+int parse_cpu_list(const char* list, int* cpus, int max) {
+    int count = 0;
+    const char* c = list;
+    while (*c) {
+        if (!isdigit((unsigned char)*c)) return -1;
+        int lo = (int)strtol(c, (char**)&c, 10);
+        int hi = lo;
+        if (*c == '-') {
+            c++;
+            if (!isdigit((unsigned char)*c)) return -1;
+            hi = (int)strtol(c, (char**)&c, 10);
+        }
+        if (hi < lo) return -1;
+        for (int v = lo; v <= hi && count < max; v++) cpus[count++] = v;
+        if (*c == ',') c++;
+        else if (*c) return -1;
+    }
+    return count;
+}
+
+// CPU order for an affinity policy: compact, scatter, core (one thread per physical
+// core, no SMT siblings) or an explicit CPU list. Thread i runs on cpus[i % count].
+int affinity_cpu_order(const char* policy, int* cpus, int max) {
+    if (isdigit((unsigned char)policy[0])) return parse_cpu_list(policy, cpus, max);
+
+    CpuInfo* topo = (CpuInfo*)malloc(AFFINITY_MAX_CPUS * sizeof(CpuInfo));
+    if (!topo) return -1;
+    int n = load_topology(topo, AFFINITY_MAX_CPUS);
+
+    int count = 0;
+    if (strcmp(policy, "compact") == 0 || strcmp(policy, "core") == 0) {
+        qsort(topo, n, sizeof(CpuInfo), compare_compact);
+    } else if (strcmp(policy, "scatter") == 0) {
+        qsort(topo, n, sizeof(CpuInfo), compare_scatter);
+    } else {
+        free(topo);
+        return -1;
+    }
+
+    for (int i = 0; i < n && count < max; i++) {
+        if (strcmp(policy, "core") == 0 && topo[i].smt > 0) continue;
+        cpus[count++] = topo[i].cpu;
+    }
+
+    free(topo);
+    return count;
+}
+
+// CPU order of the active -A policy, kept for affinity_bind; affinity_count is 0 when
+// no policy is set
+static int* affinity_order = NULL;
+static int affinity_count = 0;
+
+// CPU the calling thread is pinned to, so re-binding an already placed thread is free
+static int bound_cpu = -1;
+#pragma omp threadprivate(bound_cpu)
+
+// Pin the calling thread to its CPU in the -A order; a no-op without a policy. The slot
+// is the thread's position flattened over all enclosing teams, so with nested teams
+// (batch mode) outer thread i's team of n gets slots i*n .. i*n+n-1, a block of
+// consecutive CPUs. Engines call this at the start of each parallel region: a thread
+// created later inherits its creator's CPU, which would otherwise put the workers of a
+// nested or larger team all on one CPU. Returns 0 if sched_setaffinity fails.
+int affinity_bind(void) {
+    if (affinity_count == 0) return 1;
+
+    int slot = 0;
+    for (int level = 1; level <= omp_get_level(); level++) {
+        slot = slot * omp_get_team_size(level) + omp_get_ancestor_thread_num(level);
+    }
+    int cpu = affinity_order[slot % affinity_count];
+    if (cpu == bound_cpu) return 1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) return 0;
+    bound_cpu = cpu;
+    return 1;
+}
+
+// Set the affinity policy for the rest of the run, pin a team of config->num_threads
+// and report where each thread runs. The order stays in effect: every engine region
+// re-binds its threads with affinity_bind, including nested per-image teams.
+int apply_affinity(ConvConfig* config) {
+    int* cpus = (int*)malloc(AFFINITY_MAX_CPUS * sizeof(int));
+    if (!cpus) return 0;
+
+    int count = affinity_cpu_order(config->affinity, cpus, AFFINITY_MAX_CPUS);
+    if (count <= 0) {
+        fprintf(stderr, "Invalid affinity policy or empty CPU set: %s\n", config->affinity);
+        free(cpus);
+        return 0;
+    }
+
+    int threads = config->num_threads;
+    int* placed = (int*)malloc(threads * sizeof(int));
+    int failed = 0;
+    if (!placed) {
+        free(cpus);
+        return 0;
+    }
+
+    free(affinity_order);
+    affinity_order = cpus;
+    affinity_count = count;
+
+    omp_set_num_threads(threads);
+
+    #pragma omp parallel reduction(+:failed)
+    {
+        if (!affinity_bind()) failed++;
+        placed[omp_get_thread_num()] = sched_getcpu();
+    }
+
+    printf("Thread affinity (%s, %d CPU%s):\n", config->affinity, count, count > 1 ? "s" : "");
+    for (int t = 0; t < threads; t++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", placed[t]);
+        int core = read_int_file(path, -1);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", placed[t]);
+        int package = read_int_file(path, -1);
+        printf("  Thread %d -> CPU %d (package %d, core %d)\n", t, placed[t], package, core);
+    }
+    if (failed) {
+        fprintf(stderr, "Warning: sched_setaffinity failed for %d thread(s)\n", failed);
+    }
+
+    free(placed);
+    return 1;
+}
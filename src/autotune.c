@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Rows of the input timed per candidate (a centered band keeps the full row length)
+#define AUTOTUNE_SAMPLE_ROWS 256
+
+// Timed runs per candidate; the minimum is kept
+#define AUTOTUNE_REPS 3
+
+// A candidate whose first run is this much slower than the best is not repeated
+#define AUTOTUNE_PRUNE_RATIO 1.5
+
+#define WISDOM_LINE_MAX 512
+
+// CPU model string from /proc/cpuinfo ("unknown" if absent)
+static void cpu_model_name(char* buf, int size) {
+    snprintf(buf, size, "unknown");
+    FILE* f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+
+    char line[WISDOM_LINE_MAX];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char* value = strchr(line, ':');
+            if (value) {
+                value++;
+                while (*value == ' ' || *value == '\t') value++;
+                value[strcspn(value, "\n")] = '\0';
+                // ';' separates wisdom fields
+                for (char* c = value; *c; c++) {
+                    if (*c == ';') *c = ',';
+                }
+                snprintf(buf, size, "%s", value);
+            }
+            break;
+        }
+    }
+    fclose(f);
+}
+
+void make_tune_key(TuneKey* key, Image* input, int kernel_size) {
+    key->width = input->width;
+    key->height = input->height;
+    key->channels = input->channels;
+    key->type = input->type;
+    key->kernel_size = kernel_size;
+    cpu_model_name(key->cpu, sizeof(key->cpu));
+}
+
+// $CONV_WISDOM, else ~/.convolution_wisdom
+const char* default_wisdom_path(void) {
+    static char path[512];
+    const char* env = getenv("CONV_WISDOM");
+    if (env && env[0]) return env;
+    const char* home = getenv("HOME");
+    snprintf(path, sizeof(path), "%s/.convolution_wisdom", home ? home : ".");
+    return path;
+}
+
+// Key part of a wisdom line: "cpu=...;image=WxHxC;type=..;kernel=K;"
+static void format_key(const TuneKey* key, char* buf, int size) {
+    snprintf(buf, size, "cpu=%s;image=%dx%dx%d;type=%s;kernel=%d;", key->cpu, key->width, key->height,
+             key->channels, pixel_type_name(key->type), key->kernel_size);
+}
+
+// Parse the settings after the key; returns 1 if every field is present and valid
+static int parse_settings(const char* s, ConvConfig* tuned, double* seconds) {
+    char schedule[16];
+    int threads, chunk, tile_w, tile, order;
+    if (sscanf(s, "threads=%d;schedule=%15[a-z];chunk=%d;tile=%dx%d;order=%d;time=%lf", &threads, schedule,
+               &chunk, &tile_w, &tile, &order, seconds) != 7) {
+        return 0;
+    }
+    if (threads < 1 || chunk < 1 || tile < 0 || tile_w < 0 || (order != 0 && order != 1)) return 0;
+
+    tuned->num_threads = threads;
+    snprintf(tuned->schedule_type, sizeof(tuned->schedule_type), "%s", schedule);
+    tuned->chunk_size = chunk;
+    tuned->tile_size = tile;
+    tuned->tile_width = tile_w != tile ? tile_w : 0;
+    tuned->loop_order = order;
+    return 1;
+}
+
+// Look up key in the wisdom file; the last matching line wins. Returns 1 if found.
+int load_wisdom(const char* path, const TuneKey* key, ConvConfig* tuned) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+
+    char prefix[WISDOM_LINE_MAX];
+    char line[WISDOM_LINE_MAX];
+    int found = 0;
+    format_key(key, prefix, sizeof(prefix));
+    size_t prefix_len = strlen(prefix);
+
+    while (fgets(line, sizeof(line), f)) {
+        double seconds;
+        if (strncmp(line, prefix, prefix_len) == 0 && parse_settings(line + prefix_len, tuned, &seconds)) {
+            found = 1;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// Store the tuned settings for key, replacing any earlier entry for the same key
+int save_wisdom(const char* path, const TuneKey* key, const ConvConfig* tuned, double seconds) {
+    char prefix[WISDOM_LINE_MAX];
+    char tmp_path[600];
+    format_key(key, prefix, sizeof(prefix));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write wisdom file: %s\n", tmp_path);
+        return 0;
+    }
+
+    FILE* in = fopen(path, "r");
+    if (in) {
+        char line[WISDOM_LINE_MAX];
+        while (fgets(line, sizeof(line), in)) {
+            if (strncmp(line, prefix, strlen(prefix)) != 0) fputs(line, out);
+        }
+        fclose(in);
+    }
+    fprintf(out, "%sthreads=%d;schedule=%s;chunk=%d;tile=%dx%d;order=%d;time=%.6f\n", prefix, tuned->num_threads,
+            tuned->schedule_type, tuned->chunk_size, tuned->tile_width > 0 ? tuned->tile_width : tuned->tile_size,
+            tuned->tile_size, tuned->loop_order, seconds);
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Cannot write wisdom file: %s\n", path);
+        remove(tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+// Copy the tuned settings into config, except those in `given` (set on the command line)
+void apply_wisdom(const ConvConfig* tuned, ConvConfig* config, unsigned given) {
+    if (!(given & TUNE_THREADS)) config->num_threads = tuned->num_threads;
+    if (!(given & TUNE_SCHEDULE)) memcpy(config->schedule_type, tuned->schedule_type, sizeof(config->schedule_type));
+    if (!(given & TUNE_CHUNK)) config->chunk_size = tuned->chunk_size;
+    if (!(given & TUNE_TILE)) {
+        config->tile_size = tuned->tile_size;
+        config->tile_width = tuned->tile_width;
+    }
+    if (!(given & TUNE_ORDER)) config->loop_order = tuned->loop_order;
+}
+
+typedef struct {
+    Image* sample;
+    Image* output;
+    float** kernel;
+    int kernel_size;
+    ConvConfig best;
+    double best_time;
+    int candidates;
+    int pruned;
+} Tuner;
+
+// Time one candidate (minimum of AUTOTUNE_REPS runs, or one run if clearly slower than
+// the best so far) and keep it if it is the fastest. Returns its time, or 0 if the
+// candidate failed to run.
+static double try_config(Tuner* t, const ConvConfig* candidate) {
+    ConvConfig c = *candidate;
+    double best = 0.0;
+
+    for (int rep = 0; rep < AUTOTUNE_REPS; rep++) {
+        double start = get_time();
+        if (!convolve_direct(t->sample, t->output, t->kernel, t->kernel_size, 0, NULL, &c)) {
+            t->candidates++;
+            return 0.0;
+        }
+        double elapsed = get_time() - start;
+        if (rep == 0 || elapsed < best) best = elapsed;
+
+        if (rep == 0 && t->best_time > 0.0 && elapsed > AUTOTUNE_PRUNE_RATIO * t->best_time) {
+            t->pruned++;
+            break;
+        }
+    }
+
+    t->candidates++;
+    char tile[32];
+    snprintf(tile, sizeof(tile), "%dx%d", c.tile_width > 0 ? c.tile_width : c.tile_size, c.tile_size);
+    printf("  threads=%-3d schedule=%-7s chunk=%-3d tile=%-8s order=%d  %.6f s%s\n", c.num_threads,
+           c.schedule_type, c.chunk_size, tile, c.loop_order, best,
+           t->best_time == 0.0 || best < t->best_time ? " *" : "");
+
+    if (t->best_time == 0.0 || best < t->best_time) {
+        t->best = c;
+        t->best_time = best;
+    }
+    return best;
+}
+
+// Search threads, loop order, schedule/chunk and tile size for the direct engine on a
+// centered band of the input, one dimension at a time starting from the best point so far
+// (coordinate descent). Chunk sizes grow per schedule until a step is more than 10%
+// slower; a candidate's first run already far behind the best is not repeated. The
+// winner is written to `tuned`; returns its time on the sample, or 0 on failure.
+double autotune_direct(Image* input, float** kernel, int kernel_size, const ConvConfig* base, ConvConfig* tuned) {
+    int rows = input->height < AUTOTUNE_SAMPLE_ROWS ? input->height : AUTOTUNE_SAMPLE_ROWS;
+    long row_bytes = (long)input->width * input->channels * pixel_size(input->type);
+    Tuner t = {0};
+
+    t.sample = create_image_typed(input->width, rows, input->channels, input->type);
+    t.output = create_image_typed(input->width, rows, input->channels, input->type);
+    if (!t.sample || !t.output) {
+        fprintf(stderr, "Failed to allocate autotuning buffers\n");
+        free_image(t.sample);
+        free_image(t.output);
+        return 0.0;
+    }
+    memcpy(t.sample->data, input->data + (long)((input->height - rows) / 2) * row_bytes, rows * row_bytes);
+    t.kernel = kernel;
+    t.kernel_size = kernel_size;
+
+    int procs = omp_get_num_procs();
+    printf("Autotuning on %dx%d sample (%d CPUs, best of %d runs)...\n", input->width, rows, procs, AUTOTUNE_REPS);
+
+    // Threads, with the default schedule
+    ConvConfig c = *base;
+    snprintf(c.schedule_type, sizeof(c.schedule_type), "static");
+    c.chunk_size = 1;
+    c.tile_size = 0;
+    c.tile_width = 0;
+    c.loop_order = 0;
+    for (int n = 1; ; n *= 2) {
+        c.num_threads = n < procs ? n : procs;
+        try_config(&t, &c);
+        if (n >= procs) break;
+    }
+
+    // Loop order
+    c = t.best;
+    c.loop_order = 1 - c.loop_order;
+    try_config(&t, &c);
+
+    // Schedule and chunk
+    static const char* schedules[] = {"static", "dynamic", "guided"};
+    static const int chunks[] = {1, 4, 16, 64};
+    ConvConfig start = t.best;
+    for (int s = 0; s < 3; s++) {
+        double prev = 0.0;
+        for (int k = 0; k < 4; k++) {
+            c = start;
+            snprintf(c.schedule_type, sizeof(c.schedule_type), "%s", schedules[s]);
+            c.chunk_size = chunks[k];
+            if (strcmp(c.schedule_type, start.schedule_type) == 0 && c.chunk_size == start.chunk_size) continue;
+            double time = try_config(&t, &c);
+            if (prev > 0.0 && time > 1.1 * prev) break;
+            prev = time;
+        }
+    }
+    c = start;
+    snprintf(c.schedule_type, sizeof(c.schedule_type), "steal");
+    try_config(&t, &c);
+
+    // Tile size, with the best schedule: square tiles and the cache-derived shape
+    static const int tiles[] = {16, 32, 64};
+    start = t.best;
+    for (int k = 0; k < 3; k++) {
+        c = start;
+        c.tile_size = tiles[k];
+        c.tile_width = 0;
+        if (c.tile_size != start.tile_size) try_config(&t, &c);
+    }
+    c = start;
+    choose_tile_shape(input->width, input->height, input->channels, input->type, kernel_size, c.num_threads,
+                      &c.tile_width, &c.tile_size);
+    try_config(&t, &c);
+
+    printf("Autotuning done: %d candidates (%d pruned early)\n", t.candidates, t.pruned);
+
+    *tuned = t.best;
+    free_image(t.sample);
+    free_image(t.output);
+    return t.best_time;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Multiply-adds one thread of an image's sub-team should get at least; below this the
+// fork/join, the tail imbalance and the per-image setup outweigh the split
+#define BATCH_MIN_WORK_PER_THREAD (4L * 1024 * 1024)
+
+// Images in flight share the last-level cache: their input and output planes together
+// may take this fraction of it
+#define BATCH_CACHE_FRACTION 0.5
+
+// Split num_threads into images in flight x threads per image for `count` images of
+// width x height x channels with a kernel_size kernel.
+//
+// Each image carries serial work (decode, conversion, encode) and a fork/join per
+// parallel loop, so a thread running whole images on its own is the most efficient
+// use of it: as many images as threads are in flight while there are enough images.
+// Fewer go in flight when their input and output planes would not fit in
+// BATCH_CACHE_FRACTION of the last-level cache, or when there are fewer images than
+// threads; the spare threads then form sub-teams, as long as every thread of a team
+// still gets BATCH_MIN_WORK_PER_THREAD multiply-adds.
+void choose_batch_split(int width, int height, int channels, PixelType type, int kernel_size, int num_threads,
+                        int count, int* images, int* threads_per_image) {
+    long footprint = 2L * width * height * channels * pixel_size(type);
+    long work = (long)width * height * channels * kernel_size * kernel_size;
+    long fit = (long)(BATCH_CACHE_FRACTION * cache_size(3)) / (footprint > 0 ? footprint : 1);
+
+    int m = num_threads;
+    if (m > count) m = count;
+    if (m > fit) m = fit;
+    if (m < 1) m = 1;
+
+    int t = num_threads / m;
+    long useful = work / BATCH_MIN_WORK_PER_THREAD;
+    if (t > useful) t = useful;
+    if (t < 1) t = 1;
+
+    *images = m;
+    *threads_per_image = t;
+}
+
+// Load, convolve and save one image of the batch on the calling thread's sub-team
+static int batch_image(const char* in_path, const char* out_path, Image* preloaded, int type, float** kernel,
+                       int kernel_size, ConvConfig* config, long* pixels) {
+    Image* input = preloaded ? preloaded : load_image(in_path);
+    if (input && type >= 0 && type != (int)input->type) {
+        Image* converted = convert_image(input, (PixelType)type);
+        free_image(input);
+        input = converted;
+    }
+    if (!input) return 0;
+
+    Image* output = create_image_typed(input->width, input->height, input->channels, input->type);
+    if (!output) {
+        fprintf(stderr, "Failed to create output image for %s\n", in_path);
+        free_image(input);
+        return 0;
+    }
+
+    int ok = convolve_direct(input, output, kernel, kernel_size, 0, NULL, config) && save_image(out_path, output);
+    *pixels = (long)input->width * input->height;
+
+    free_image(input);
+    free_image(output);
+    return ok;
+}
+
+// Convolve count images (in_paths[i] -> out_paths[i]) with the direct engine. Images
+// are handed out dynamically to an outer team of `images` threads; each runs its image
+// on a nested team of `threads_per_image`, so loading and saving overlap with other
+// images' convolutions. images = 0 picks the split from the first image and the kernel
+// (see choose_batch_split); otherwise threads_per_image is num_threads / images. type
+// converts the samples (-1 keeps each file's type). Returns the number of images done.
+int convolve_batch(char** in_paths, char** out_paths, int count, int type, float** kernel, int kernel_size,
+                   int images, ConvConfig* config, BatchStats* stats) {
+    // The first image sets the split; it is processed as part of the batch
+    Image* first = load_image(in_paths[0]);
+    if (!first) return 0;
+
+    int threads_per_image;
+    if (images > 0) {
+        if (images > count) images = count;
+        threads_per_image = config->num_threads / images > 0 ? config->num_threads / images : 1;
+    } else {
+        choose_batch_split(first->width, first->height, first->channels,
+                           type >= 0 ? (PixelType)type : first->type, kernel_size, config->num_threads, count,
+                           &images, &threads_per_image);
+    }
+    printf("Batch split: %d image%s in flight x %d thread%s each\n\n", images, images > 1 ? "s" : "",
+           threads_per_image, threads_per_image > 1 ? "s" : "");
+
+    ConvConfig inner = *config;
+    inner.num_threads = threads_per_image;
+
+    // One set of -s adaptive weights per outer thread: its nested team is reused from
+    // image to image, so what a team learns on one image seeds the next
+    ThreadWeights* weights = NULL;
+    if (strcmp(config->schedule_type, "adaptive") == 0) {
+        weights = (ThreadWeights*)calloc(images, sizeof(ThreadWeights));
+    }
+
+    int done = 0;
+    long pixels = 0;
+    double start = get_time();
+
+    omp_set_max_active_levels(2);
+    omp_set_num_threads(images);
+
+    #pragma omp parallel for schedule(dynamic, 1) firstprivate(inner) reduction(+:done, pixels)
+    for (int i = 0; i < count; i++) {
+        long n = 0;
+        if (weights) inner.weights = &weights[omp_get_thread_num()];
+        if (batch_image(in_paths[i], out_paths[i], i == 0 ? first : NULL, type, kernel, kernel_size, &inner, &n)) {
+            done++;
+            pixels += n;
+        }
+    }
+
+    if (stats) {
+        stats->images = done;
+        stats->failed = count - done;
+        stats->in_flight = images;
+        stats->threads_per_image = threads_per_image;
+        stats->pixels = pixels;
+        stats->elapsed = get_time() - start;
+        stats->weights = weights;
+    } else {
+        free(weights);
+    }
+    return done;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "convolution.h"
+
+#define CACHE_MAX_LEVEL 3
+
+// Used when sysfs does not report a level
+static const long default_cache_bytes[CACHE_MAX_LEVEL + 1] = {0, 32 * 1024, 256 * 1024, 8 * 1024 * 1024};
+
+static long cache_bytes[CACHE_MAX_LEVEL + 1];
+static int cache_loaded = 0;
+
+// Read data/unified cache sizes of cpu0 from /sys/devices/system/cpu/cpu0/cache/index* (once)
+static void load_cache_sizes(void) {
+    if (cache_loaded) return;
+    memcpy(cache_bytes, default_cache_bytes, sizeof(cache_bytes));
+
+    for (int i = 0; i < 16; i++) {
+        char path[128];
+        char type[32] = "";
+        char size[32] = "";
+        int level = 0;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        FILE* f = fopen(path, "r");
+        if (!f) break;
+        if (fscanf(f, "%d", &level) != 1) level = 0;
+        fclose(f);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        f = fopen(path, "r");
+        if (f) {
+            if (fscanf(f, "%31s", type) != 1) type[0] = '\0';
+            fclose(f);
+        }
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        f = fopen(path, "r");
+        if (f) {
+            if (fscanf(f, "%31s", size) != 1) size[0] = '\0';
+            fclose(f);
+        }
+
+        if (level < 1 || level > CACHE_MAX_LEVEL || strcmp(type, "Instruction") == 0) continue;
+
+        // "48K", "2048K", "32M"
+        char* unit;
+        long bytes = strtol(size, &unit, 10);
+        if (*unit == 'K') bytes *= 1024;
+        else if (*unit == 'M') bytes *= 1024 * 1024;
+        if (bytes > 0) cache_bytes[level] = bytes;
+    }
+    cache_loaded = 1;
+}
+
+// Size in bytes of the data (or unified) cache at level 1-3 seen by one core
+long cache_size(int level) {
+    if (level < 1) level = 1;
+    if (level > CACHE_MAX_LEVEL) level = CACHE_MAX_LEVEL;
+    load_cache_sizes();
+    return cache_bytes[level];
+}
+
+// Choose a tile_w x tile_h for direct convolution with a kernel_size kernel.
+//
+// Two footprints must fit in half of their cache level (the rest is left for the
+// kernel, the stack and the other hyperthread):
+//  - L1: the kernel_size input rows under one output row of the tile, (tile_w + 2r)
+//    pixels each, so the window slides along x without refetching
+//  - L2: the whole input tile with its halo plus the output tile, so the rows stay
+//    cached as the window moves down the tile
+// Among tiles that fit, pick the one whose halo costs least (largest fraction of the
+// input footprint that is output), preferring wider tiles within 1% of the best, since
+// rows are the contiguous direction. Candidates split the image into n equal columns
+// and m equal rows (widths rounded up to 16, heights to 8) so there are no thin edge
+// tiles, and there are at least 4 tiles per thread when the image allows it.
+void choose_tile_shape(int width, int height, int channels, PixelType type, int kernel_size, int num_threads,
+                       int* tile_w, int* tile_h) {
+    long bytes = (long)channels * pixel_size(type);
+    long r = kernel_size / 2;
+    long l1_budget = cache_size(1) / 2;
+    long l2_budget = cache_size(2) / 2;
+    long min_tiles = 4L * (num_threads > 0 ? num_threads : 1);
+    long max_tiles = (long)((width + 15) / 16) * ((height + 7) / 8);
+    if (min_tiles > max_tiles) min_tiles = max_tiles;
+
+    double best = -1.0;
+    int best_w = width < 16 ? width : 16;
+    int best_h = height < 8 ? height : 8;
+
+    // First pass finds the best halo ratio, second the widest tile within 1% of it
+    for (int pass = 0; pass < 2; pass++) {
+        for (int n = 1; n <= (width + 15) / 16; n++) {
+            int w = ((width + n - 1) / n + 15) & ~15;
+            if (w > width) w = width;
+            if ((long)kernel_size * (w + 2 * r) * bytes > l1_budget) continue;
+
+            for (int m = 1; m <= (height + 7) / 8; m++) {
+                int h = ((height + m - 1) / m + 7) & ~7;
+                if (h > height) h = height;
+                long footprint = ((w + 2 * r) * (h + 2 * r) + (long)w * h) * bytes;
+                long tiles = (long)((width + w - 1) / w) * ((height + h - 1) / h);
+                if (footprint > l2_budget || tiles < min_tiles) continue;
+
+                double ratio = (double)w * h / ((w + 2 * r) * (h + 2 * r));
+                if (pass == 0 && ratio > best) {
+                    best = ratio;
+                    best_w = w;
+                    best_h = h;
+                } else if (pass == 1 && ratio >= 0.99 * best && w > best_w) {
+                    best_w = w;
+                    best_h = h;
+                }
+                break;      // larger m only shrinks the tile
+            }
+        }
+    }
+
+    *tile_w = best_w;
+    *tile_h = best_h;
+}
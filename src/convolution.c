@@ -10,8 +10,332 @@ double get_time() {
     return omp_get_wtime();
 }
 
+// Map the configured schedule onto the runtime schedule used by the typed engines
+static void set_runtime_schedule(ConvConfig* config) {
+    omp_sched_t kind = omp_sched_static;
+    if (strcmp(config->schedule_type, "dynamic") == 0) {
+        kind = omp_sched_dynamic;
+    } else if (strcmp(config->schedule_type, "guided") == 0) {
+        kind = omp_sched_guided;
+    }
+    omp_set_schedule(kind, config->chunk_size);
+}
+
+// Saturating stores for each sample type (u8 matches the hand-written engines)
+#define STORE_U8(v) ((uint8_t)fmin(fmax((v), 0.0f), 255.0f))
+#define STORE_U16(v) ((uint16_t)fminf(fmaxf((v), 0.0f), 65535.0f))
+#define STORE_F32(v) (v)
+
+// Generate the direct engines for one sample type. The 8-bit engines below are kept
+// as hand-written baselines; these cover the wider types with one schedule(runtime) loop.
+#define DEFINE_TYPED_ENGINES(SUFFIX, T, STORE)                                                  \
+static inline void convolve_pixel_##SUFFIX(const T* in, T* out, int width, int height,         \
+                                           int channels, float** kernel, int kernel_size,      \
+                                           int x, int y) {                                     \
+    int half_kernel = kernel_size / 2;                                                         \
+    for (int c = 0; c < channels; c++) {                                                       \
+        float sum = 0.0f;                                                                      \
+        for (int ky = 0; ky < kernel_size; ky++) {                                             \
+            int img_y = y + ky - half_kernel;                                                  \
+            if (img_y < 0 || img_y >= height) continue;                                        \
+            for (int kx = 0; kx < kernel_size; kx++) {                                         \
+                int img_x = x + kx - half_kernel;                                              \
+                if (img_x >= 0 && img_x < width) {                                             \
+                    sum += in[((long)img_y * width + img_x) * channels + c] * kernel[ky][kx];  \
+                }                                                                              \
+            }                                                                                  \
+        }                                                                                      \
+        out[((long)y * width + x) * channels + c] = STORE(sum);                                \
+    }                                                                                          \
+}                                                                                              \
+                                                                                               \
+static void convolve_sequential_##SUFFIX(Image* input, Image* output, float** kernel,          \
+                                         int kernel_size) {                                    \
+    const T* in = (const T*)input->data;                                                       \
+    T* out = (T*)output->data;                                                                 \
+    for (int y = 0; y < input->height; y++) {                                                  \
+        for (int x = 0; x < input->width; x++) {                                               \
+            convolve_pixel_##SUFFIX(in, out, input->width, input->height, input->channels,     \
+                                    kernel, kernel_size, x, y);                                \
+        }                                                                                      \
+    }                                                                                          \
+}                                                                                              \
+                                                                                               \
+static void convolve_openmp_##SUFFIX(Image* input, Image* output, float** kernel,              \
+                                     int kernel_size, ConvConfig* config) {                    \
+    const T* in = (const T*)input->data;                                                       \
+    T* out = (T*)output->data;                                                                 \
+    int width = input->width;                                                                  \
+    int height = input->height;                                                                \
+    int channels = input->channels;                                                            \
+    omp_set_num_threads(config->num_threads);                                                  \
+    set_runtime_schedule(config);                                                              \
+    _Pragma("omp parallel")                                                                    \
+    {                                                                                          \
+        affinity_bind();                                                                       \
+        _Pragma("omp for schedule(runtime)")                                                   \
+        for (int y = 0; y < height; y++) {                                                     \
+            for (int x = 0; x < width; x++) {                                                  \
+                convolve_pixel_##SUFFIX(in, out, width, height, channels,                      \
+                                        kernel, kernel_size, x, y);                            \
+            }                                                                                  \
+        }                                                                                      \
+    }                                                                                          \
+}                                                                                              \
+static void convolve_tiled_##SUFFIX(Image* input, Image* output, float** kernel,               \
+                                    int kernel_size, ConvConfig* config) {                     \
+    const T* in = (const T*)input->data;                                                       \
+    T* out = (T*)output->data;                                                                 \
+    int width = input->width;                                                                  \
+    int height = input->height;                                                                \
+    int tile_h = config->tile_size;                                                            \
+    int tile_w = config->tile_width > 0 ? config->tile_width : tile_h;                         \
+    int num_tiles_y = (height + tile_h - 1) / tile_h;                                          \
+    int num_tiles_x = (width + tile_w - 1) / tile_w;                                           \
+    omp_set_num_threads(config->num_threads);                                                  \
+    set_runtime_schedule(config);                                                              \
+    _Pragma("omp parallel")                                                                    \
+    {                                                                                          \
+        affinity_bind();                                                                       \
+        _Pragma("omp for schedule(runtime) collapse(2)")                                       \
+        for (int ty = 0; ty < num_tiles_y; ty++) {                                             \
+            for (int tx = 0; tx < num_tiles_x; tx++) {                                         \
+                int y_end = (ty + 1) * tile_h < height ? (ty + 1) * tile_h : height;           \
+                int x_end = (tx + 1) * tile_w < width ? (tx + 1) * tile_w : width;             \
+                for (int y = ty * tile_h; y < y_end; y++) {                                    \
+                    for (int x = tx * tile_w; x < x_end; x++) {                                \
+                        convolve_pixel_##SUFFIX(in, out, width, height, input->channels,       \
+                                                kernel, kernel_size, x, y);                    \
+                    }                                                                          \
+                }                                                                              \
+            }                                                                                  \
+        }                                                                                      \
+    }                                                                                          \
+}
+
+DEFINE_TYPED_ENGINES(u16, uint16_t, STORE_U16)
+DEFINE_TYPED_ENGINES(f32, float, STORE_F32)
+
+// X-first order on transposed buffers: image column x is row x of in_t/out_t (stride
+// samples apart), so the walk down a column is unit stride. The window sum keeps the
+// ky-then-kx order.
+#define DEFINE_TRANSPOSED_COLUMNS(SUFFIX, T, STORE)                                            \
+static void convolve_columns_##SUFFIX(const T* in_t, T* out_t, long stride, int width,         \
+                                      int height, int channels, float** kernel,                \
+                                      int kernel_size) {                                       \
+    int half_kernel = kernel_size / 2;                                                         \
+    _Pragma("omp parallel")                                                                    \
+    {                                                                                          \
+        affinity_bind();                                                                       \
+        _Pragma("omp for schedule(runtime)")                                                   \
+        for (int x = 0; x < width; x++) {                                                      \
+            for (int y = 0; y < height; y++) {                                                 \
+                for (int c = 0; c < channels; c++) {                                           \
+                    float sum = 0.0f;                                                          \
+                    for (int ky = 0; ky < kernel_size; ky++) {                                 \
+                        int img_y = y + ky - half_kernel;                                      \
+                        if (img_y < 0 || img_y >= height) continue;                            \
+                        for (int kx = 0; kx < kernel_size; kx++) {                             \
+                            int img_x = x + kx - half_kernel;                                  \
+                            if (img_x >= 0 && img_x < width) {                                 \
+                                sum += in_t[(long)img_x * stride +                             \
+                                            (long)img_y * channels + c] * kernel[ky][kx];      \
+                            }                                                                  \
+                        }                                                                      \
+                    }                                                                          \
+                    out_t[(long)x * stride + (long)y * channels + c] = STORE(sum);             \
+                }                                                                              \
+            }                                                                                  \
+        }                                                                                      \
+    }                                                                                          \
+}
+
+DEFINE_TRANSPOSED_COLUMNS(u8, uint8_t, STORE_U8)
+DEFINE_TRANSPOSED_COLUMNS(u16, uint16_t, STORE_U16)
+DEFINE_TRANSPOSED_COLUMNS(f32, float, STORE_F32)
+
+// X-first loop order (-l 1). Walking down a column of a row-major image touches one
+// cache line per pixel, so the input is transposed with cache-blocked copies, the
+// columns are convolved as contiguous rows, and the result is transposed back. The
+// two transposes cost about two streaming copies of the image. The transposed rows are
+// padded (transpose_row_stride) so that neighbouring columns do not alias in L1.
+static int convolve_transposed(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    int sample = pixel_size(input->type);
+    int bytes = channels * sample;
+    long stride = transpose_row_stride((long)height * bytes);
+    uint8_t* in_t = (uint8_t*)aligned_alloc(64, width * stride);
+    uint8_t* out_t = (uint8_t*)aligned_alloc(64, width * stride);
+    if (!in_t || !out_t) {
+        fprintf(stderr, "Failed to allocate transpose buffers\n");
+        free(in_t);
+        free(out_t);
+        return 0;
+    }
+
+    transpose_pixels(input->data, (long)width * bytes, in_t, stride, width, height, bytes, config->num_threads);
+
+    omp_set_num_threads(config->num_threads);
+    set_runtime_schedule(config);
+    if (input->type == PIXEL_U16) {
+        convolve_columns_u16((const uint16_t*)in_t, (uint16_t*)out_t, stride / sample, width, height, channels,
+                             kernel, kernel_size);
+    } else if (input->type == PIXEL_F32) {
+        convolve_columns_f32((const float*)in_t, (float*)out_t, stride / sample, width, height, channels, kernel,
+                             kernel_size);
+    } else {
+        convolve_columns_u8(in_t, out_t, stride, width, height, channels, kernel, kernel_size);
+    }
+
+    transpose_pixels(out_t, stride, output->data, (long)width * bytes, height, width, bytes, config->num_threads);
+    free(in_t);
+    free(out_t);
+    return 1;
+}
+
+// Tile edge for -s steal when no tile size is configured (-s adaptive uses rows)
+#define STEAL_DEFAULT_TILE 32
+
+// 8-bit pixel with the same arithmetic as the hand-written engines
+static inline void convolve_pixel_u8(const uint8_t* in, uint8_t* out, int width, int height,
+                                     int channels, float** kernel, int kernel_size, int x, int y) {
+    int half_kernel = kernel_size / 2;
+    for (int c = 0; c < channels; c++) {
+        float sum = 0.0f;
+        for (int ky = 0; ky < kernel_size; ky++) {
+            for (int kx = 0; kx < kernel_size; kx++) {
+                int img_y = y + ky - half_kernel;
+                int img_x = x + kx - half_kernel;
+                if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
+                    int idx = (img_y * width + img_x) * channels + c;
+                    sum += in[idx] * kernel[ky][kx];
+                }
+            }
+        }
+        out[(y * width + x) * channels + c] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
+    }
+}
+
+typedef struct {
+    Image* input;
+    Image* output;
+    float** kernel;
+    int kernel_size;
+    int tile_w;
+    int tile_h;
+    int tiles_x;
+} StealJob;
+
+// Output pixels [x0, x1) x [y0, y1), any sample type
+static void convolve_rect(Image* in, Image* out, float** kernel, int kernel_size, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            if (in->type == PIXEL_U16) {
+                convolve_pixel_u16(IMAGE_U16(in), IMAGE_U16(out), in->width, in->height,
+                                   in->channels, kernel, kernel_size, x, y);
+            } else if (in->type == PIXEL_F32) {
+                convolve_pixel_f32(IMAGE_F32(in), IMAGE_F32(out), in->width, in->height,
+                                   in->channels, kernel, kernel_size, x, y);
+            } else {
+                convolve_pixel_u8(in->data, out->data, in->width, in->height,
+                                  in->channels, kernel, kernel_size, x, y);
+            }
+        }
+    }
+}
+
+static void convolve_tile_task(int task, int thread, void* arg) {
+    StealJob* job = (StealJob*)arg;
+    Image* in = job->input;
+    int x0 = (task % job->tiles_x) * job->tile_w;
+    int y0 = (task / job->tiles_x) * job->tile_h;
+    int x1 = x0 + job->tile_w < in->width ? x0 + job->tile_w : in->width;
+    int y1 = y0 + job->tile_h < in->height ? y0 + job->tile_h : in->height;
+    (void)thread;
+
+    convolve_rect(in, job->output, job->kernel, job->kernel_size, x0, y0, x1, y1);
+}
+
+// Row-major tiles on per-thread work-stealing deques (-s steal)
+static int convolve_steal(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+    int tile_h = config->tile_size > 0 ? config->tile_size : STEAL_DEFAULT_TILE;
+    int tile_w = config->tile_width > 0 ? config->tile_width : tile_h;
+    StealJob job = {input, output, kernel, kernel_size, tile_w, tile_h, (input->width + tile_w - 1) / tile_w};
+    int tiles_y = (input->height + tile_h - 1) / tile_h;
+    return steal_for(job.tiles_x * tiles_y, config, convolve_tile_task, &job, NULL);
+}
+
+// Rows, or row-major tiles when a tile size is configured, in contiguous per-thread
+// ranges sized by measured throughput (-s adaptive)
+static void convolve_adaptive(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+    int tile_h = config->tile_size > 0 ? config->tile_size : 1;
+    int tile_w = config->tile_size > 0 ? (config->tile_width > 0 ? config->tile_width : tile_h) : input->width;
+    StealJob job = {input, output, kernel, kernel_size, tile_w, tile_h, (input->width + tile_w - 1) / tile_w};
+    int tiles_y = (input->height + tile_h - 1) / tile_h;
+    adaptive_for(job.tiles_x * tiles_y, config, convolve_tile_task, &job, NULL);
+}
+
+// Base case of the recursive engine: small enough that the block, its halo and the
+// kernel stay in L1 on any current core
+#define RECURSIVE_BASE_PIXELS (16 * 16)
+
+// Regions smaller than this run their whole subtree in the current task
+#define RECURSIVE_TASK_PIXELS (128 * 128)
+
+// Halve [x0, x1) x [y0, y1) along its longer side until it reaches the base case. The two
+// halves are visited in order, so the traversal is a Z-order-like curve whose blocks are
+// local at every scale: whatever the cache sizes, some level of the recursion fits each.
+static void convolve_recursive_region(Image* in, Image* out, float** kernel, int kernel_size,
+                                      int x0, int y0, int x1, int y1) {
+    long w = x1 - x0;
+    long h = y1 - y0;
+    if (w * h <= RECURSIVE_BASE_PIXELS || (w == 1 && h == 1)) {
+        convolve_rect(in, out, kernel, kernel_size, x0, y0, x1, y1);
+        return;
+    }
+
+    int big = w * h >= RECURSIVE_TASK_PIXELS;
+    if (w >= h) {
+        int xm = x0 + (int)(w / 2);
+        #pragma omp task if (big)
+        convolve_recursive_region(in, out, kernel, kernel_size, x0, y0, xm, y1);
+        #pragma omp task if (big)
+        convolve_recursive_region(in, out, kernel, kernel_size, xm, y0, x1, y1);
+    } else {
+        int ym = y0 + (int)(h / 2);
+        #pragma omp task if (big)
+        convolve_recursive_region(in, out, kernel, kernel_size, x0, y0, x1, ym);
+        #pragma omp task if (big)
+        convolve_recursive_region(in, out, kernel, kernel_size, x0, ym, x1, y1);
+    }
+    #pragma omp taskwait
+}
+
+// Cache-oblivious engine: recursive bisection of the output run as OpenMP tasks, with
+// no tile size to tune. Tasks stop being created below RECURSIVE_TASK_PIXELS.
+void convolve_openmp_recursive(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+    omp_set_num_threads(config->num_threads);
+
+    #pragma omp parallel
+    {
+        affinity_bind();
+        #pragma omp single
+        convolve_recursive_region(input, output, kernel, kernel_size, 0, 0, input->width, input->height);
+    }
+}
+
 // Sequential convolution (baseline)
 void convolve_sequential(Image* input, Image* output, float** kernel, int kernel_size) {
+    if (input->type == PIXEL_U16) {
+        convolve_sequential_u16(input, output, kernel, kernel_size);
+        return;
+    } else if (input->type == PIXEL_F32) {
+        convolve_sequential_f32(input, output, kernel, kernel_size);
+        return;
+    }
+
     int width = input->width;
     int height = input->height;
     int channels = input->channels;
@@ -43,7 +367,22 @@ void convolve_sequential(Image* input, Image* output, float** kernel, int kernel
 }
 
 // OpenMP parallel convolution with configurable scheduling
-void convolve_openmp(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+int convolve_openmp(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+    if (strcmp(config->schedule_type, "steal") == 0) {
+        return convolve_steal(input, output, kernel, kernel_size, config);
+    } else if (strcmp(config->schedule_type, "adaptive") == 0) {
+        convolve_adaptive(input, output, kernel, kernel_size, config);
+        return 1;
+    } else if (config->loop_order == 1) {
+        return convolve_transposed(input, output, kernel, kernel_size, config);
+    } else if (input->type == PIXEL_U16) {
+        convolve_openmp_u16(input, output, kernel, kernel_size, config);
+        return 1;
+    } else if (input->type == PIXEL_F32) {
+        convolve_openmp_f32(input, output, kernel, kernel_size, config);
+        return 1;
+    }
+
     int width = input->width;
     int height = input->height;
     int channels = input->channels;
@@ -52,11 +391,12 @@ void convolve_openmp(Image* input, Image* output, float** kernel, int kernel_siz
     // Set number of threads
     omp_set_num_threads(config->num_threads);
 
-    // Determine scheduling type
-    if (config->loop_order == 0) {
-        // Y-first loop order
-        if (strcmp(config->schedule_type, "static") == 0) {
-            #pragma omp parallel for schedule(static, config->chunk_size) collapse(1)
+    // Determine scheduling type (Y-first; X-first runs in convolve_transposed)
+    if (strcmp(config->schedule_type, "static") == 0) {
+        #pragma omp parallel
+        {
+            affinity_bind();
+            #pragma omp for schedule(static, config->chunk_size) collapse(1)
             for (int y = 0; y < height; y++) {
                 for (int x = 0; x < width; x++) {
                     for (int c = 0; c < channels; c++) {
@@ -79,8 +419,12 @@ void convolve_openmp(Image* input, Image* output, float** kernel, int kernel_siz
                     }
                 }
             }
-        } else if (strcmp(config->schedule_type, "dynamic") == 0) {
-            #pragma omp parallel for schedule(dynamic, config->chunk_size) collapse(1)
+        }
+    } else if (strcmp(config->schedule_type, "dynamic") == 0) {
+        #pragma omp parallel
+        {
+            affinity_bind();
+            #pragma omp for schedule(dynamic, config->chunk_size) collapse(1)
             for (int y = 0; y < height; y++) {
                 for (int x = 0; x < width; x++) {
                     for (int c = 0; c < channels; c++) {
@@ -103,8 +447,12 @@ void convolve_openmp(Image* input, Image* output, float** kernel, int kernel_siz
                     }
                 }
             }
-        } else if (strcmp(config->schedule_type, "guided") == 0) {
-            #pragma omp parallel for schedule(guided, config->chunk_size) collapse(1)
+        }
+    } else if (strcmp(config->schedule_type, "guided") == 0) {
+        #pragma omp parallel
+        {
+            affinity_bind();
+            #pragma omp for schedule(guided, config->chunk_size) collapse(1)
             for (int y = 0; y < height; y++) {
                 for (int x = 0; x < width; x++) {
                     for (int c = 0; c < channels; c++) {
@@ -128,195 +476,165 @@ void convolve_openmp(Image* input, Image* output, float** kernel, int kernel_siz
                 }
             }
         }
-    } else {
-        // X-first loop order
-        if (strcmp(config->schedule_type, "static") == 0) {
-            #pragma omp parallel for schedule(static, config->chunk_size) collapse(1)
-            for (int x = 0; x < width; x++) {
-                for (int y = 0; y < height; y++) {
-                    for (int c = 0; c < channels; c++) {
-                        float sum = 0.0f;
-
-                        for (int ky = 0; ky < kernel_size; ky++) {
-                            for (int kx = 0; kx < kernel_size; kx++) {
-                                int img_y = y + ky - half_kernel;
-                                int img_x = x + kx - half_kernel;
-
-                                if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
-                                    int idx = (img_y * width + img_x) * channels + c;
-                                    sum += input->data[idx] * kernel[ky][kx];
-                                }
-                            }
-                        }
-
-                        int out_idx = (y * width + x) * channels + c;
-                        output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
-                    }
-                }
-            }
-        } else if (strcmp(config->schedule_type, "dynamic") == 0) {
-            #pragma omp parallel for schedule(dynamic, config->chunk_size) collapse(1)
-            for (int x = 0; x < width; x++) {
-                for (int y = 0; y < height; y++) {
-                    for (int c = 0; c < channels; c++) {
-                        float sum = 0.0f;
-
-                        for (int ky = 0; ky < kernel_size; ky++) {
-                            for (int kx = 0; kx < kernel_size; kx++) {
-                                int img_y = y + ky - half_kernel;
-                                int img_x = x + kx - half_kernel;
-
-                                if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
-                                    int idx = (img_y * width + img_x) * channels + c;
-                                    sum += input->data[idx] * kernel[ky][kx];
-                                }
-                            }
-                        }
-
-                        int out_idx = (y * width + x) * channels + c;
-                        output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
-                    }
-                }
-            }
-        } else if (strcmp(config->schedule_type, "guided") == 0) {
-            #pragma omp parallel for schedule(guided, config->chunk_size) collapse(1)
-            for (int x = 0; x < width; x++) {
-                for (int y = 0; y < height; y++) {
-                    for (int c = 0; c < channels; c++) {
-                        float sum = 0.0f;
-
-                        for (int ky = 0; ky < kernel_size; ky++) {
-                            for (int kx = 0; kx < kernel_size; kx++) {
-                                int img_y = y + ky - half_kernel;
-                                int img_x = x + kx - half_kernel;
-
-                                if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
-                                    int idx = (img_y * width + img_x) * channels + c;
-                                    sum += input->data[idx] * kernel[ky][kx];
-                                }
-                            }
-                        }
-
-                        int out_idx = (y * width + x) * channels + c;
-                        output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
-                    }
-                }
-            }
-        }
     }
+    return 1;
 }
 
 // OpenMP parallel convolution with tiling
-void convolve_openmp_tiled(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+int convolve_openmp_tiled(Image* input, Image* output, float** kernel, int kernel_size, ConvConfig* config) {
+    if (strcmp(config->schedule_type, "steal") == 0) {
+        return convolve_steal(input, output, kernel, kernel_size, config);
+    } else if (strcmp(config->schedule_type, "adaptive") == 0) {
+        convolve_adaptive(input, output, kernel, kernel_size, config);
+        return 1;
+    } else if (input->type == PIXEL_U16) {
+        convolve_tiled_u16(input, output, kernel, kernel_size, config);
+        return 1;
+    } else if (input->type == PIXEL_F32) {
+        convolve_tiled_f32(input, output, kernel, kernel_size, config);
+        return 1;
+    }
+
     int width = input->width;
     int height = input->height;
     int channels = input->channels;
     int half_kernel = kernel_size / 2;
-    int tile_size = config->tile_size;
+    int tile_h = config->tile_size;
+    int tile_w = config->tile_width > 0 ? config->tile_width : tile_h;
 
     omp_set_num_threads(config->num_threads);
 
-    int num_tiles_y = (height + tile_size - 1) / tile_size;
-    int num_tiles_x = (width + tile_size - 1) / tile_size;
+    int num_tiles_y = (height + tile_h - 1) / tile_h;
+    int num_tiles_x = (width + tile_w - 1) / tile_w;
 
     if (strcmp(config->schedule_type, "static") == 0) {
-        #pragma omp parallel for schedule(static, config->chunk_size) collapse(2)
-        for (int ty = 0; ty < num_tiles_y; ty++) {
-            for (int tx = 0; tx < num_tiles_x; tx++) {
-                int y_start = ty * tile_size;
-                int y_end = (y_start + tile_size < height) ? y_start + tile_size : height;
-                int x_start = tx * tile_size;
-                int x_end = (x_start + tile_size < width) ? x_start + tile_size : width;
-
-                for (int y = y_start; y < y_end; y++) {
-                    for (int x = x_start; x < x_end; x++) {
-                        for (int c = 0; c < channels; c++) {
-                            float sum = 0.0f;
-
-                            for (int ky = 0; ky < kernel_size; ky++) {
-                                for (int kx = 0; kx < kernel_size; kx++) {
-                                    int img_y = y + ky - half_kernel;
-                                    int img_x = x + kx - half_kernel;
-
-                                    if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
-                                        int idx = (img_y * width + img_x) * channels + c;
-                                        sum += input->data[idx] * kernel[ky][kx];
+        #pragma omp parallel
+        {
+            affinity_bind();
+            #pragma omp for schedule(static, config->chunk_size) collapse(2)
+            for (int ty = 0; ty < num_tiles_y; ty++) {
+                for (int tx = 0; tx < num_tiles_x; tx++) {
+                    int y_start = ty * tile_h;
+                    int y_end = (y_start + tile_h < height) ? y_start + tile_h : height;
+                    int x_start = tx * tile_w;
+                    int x_end = (x_start + tile_w < width) ? x_start + tile_w : width;
+
+                    for (int y = y_start; y < y_end; y++) {
+                        for (int x = x_start; x < x_end; x++) {
+                            for (int c = 0; c < channels; c++) {
+                                float sum = 0.0f;
+
+                                for (int ky = 0; ky < kernel_size; ky++) {
+                                    for (int kx = 0; kx < kernel_size; kx++) {
+                                        int img_y = y + ky - half_kernel;
+                                        int img_x = x + kx - half_kernel;
+
+                                        if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
+                                            int idx = (img_y * width + img_x) * channels + c;
+                                            sum += input->data[idx] * kernel[ky][kx];
+                                        }
                                     }
                                 }
-                            }
 
-                            int out_idx = (y * width + x) * channels + c;
-                            output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
+                                int out_idx = (y * width + x) * channels + c;
+                                output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
+                            }
                         }
                     }
                 }
             }
         }
     } else if (strcmp(config->schedule_type, "dynamic") == 0) {
-        #pragma omp parallel for schedule(dynamic, config->chunk_size) collapse(2)
-        for (int ty = 0; ty < num_tiles_y; ty++) {
-            for (int tx = 0; tx < num_tiles_x; tx++) {
-                int y_start = ty * tile_size;
-                int y_end = (y_start + tile_size < height) ? y_start + tile_size : height;
-                int x_start = tx * tile_size;
-                int x_end = (x_start + tile_size < width) ? x_start + tile_size : width;
-
-                for (int y = y_start; y < y_end; y++) {
-                    for (int x = x_start; x < x_end; x++) {
-                        for (int c = 0; c < channels; c++) {
-                            float sum = 0.0f;
-
-                            for (int ky = 0; ky < kernel_size; ky++) {
-                                for (int kx = 0; kx < kernel_size; kx++) {
-                                    int img_y = y + ky - half_kernel;
-                                    int img_x = x + kx - half_kernel;
-
-                                    if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
-                                        int idx = (img_y * width + img_x) * channels + c;
-                                        sum += input->data[idx] * kernel[ky][kx];
+        #pragma omp parallel
+        {
+            affinity_bind();
+            #pragma omp for schedule(dynamic, config->chunk_size) collapse(2)
+            for (int ty = 0; ty < num_tiles_y; ty++) {
+                for (int tx = 0; tx < num_tiles_x; tx++) {
+                    int y_start = ty * tile_h;
+                    int y_end = (y_start + tile_h < height) ? y_start + tile_h : height;
+                    int x_start = tx * tile_w;
+                    int x_end = (x_start + tile_w < width) ? x_start + tile_w : width;
+
+                    for (int y = y_start; y < y_end; y++) {
+                        for (int x = x_start; x < x_end; x++) {
+                            for (int c = 0; c < channels; c++) {
+                                float sum = 0.0f;
+
+                                for (int ky = 0; ky < kernel_size; ky++) {
+                                    for (int kx = 0; kx < kernel_size; kx++) {
+                                        int img_y = y + ky - half_kernel;
+                                        int img_x = x + kx - half_kernel;
+
+                                        if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
+                                            int idx = (img_y * width + img_x) * channels + c;
+                                            sum += input->data[idx] * kernel[ky][kx];
+                                        }
                                     }
                                 }
-                            }
 
-                            int out_idx = (y * width + x) * channels + c;
-                            output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
+                                int out_idx = (y * width + x) * channels + c;
+                                output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
+                            }
                         }
                     }
                 }
             }
         }
     } else if (strcmp(config->schedule_type, "guided") == 0) {
-        #pragma omp parallel for schedule(guided, config->chunk_size) collapse(2)
-        for (int ty = 0; ty < num_tiles_y; ty++) {
-            for (int tx = 0; tx < num_tiles_x; tx++) {
-                int y_start = ty * tile_size;
-                int y_end = (y_start + tile_size < height) ? y_start + tile_size : height;
-                int x_start = tx * tile_size;
-                int x_end = (x_start + tile_size < width) ? x_start + tile_size : width;
-
-                for (int y = y_start; y < y_end; y++) {
-                    for (int x = x_start; x < x_end; x++) {
-                        for (int c = 0; c < channels; c++) {
-                            float sum = 0.0f;
-
-                            for (int ky = 0; ky < kernel_size; ky++) {
-                                for (int kx = 0; kx < kernel_size; kx++) {
-                                    int img_y = y + ky - half_kernel;
-                                    int img_x = x + kx - half_kernel;
-
-                                    if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
-                                        int idx = (img_y * width + img_x) * channels + c;
-                                        sum += input->data[idx] * kernel[ky][kx];
+        #pragma omp parallel
+        {
+            affinity_bind();
+            #pragma omp for schedule(guided, config->chunk_size) collapse(2)
+            for (int ty = 0; ty < num_tiles_y; ty++) {
+                for (int tx = 0; tx < num_tiles_x; tx++) {
+                    int y_start = ty * tile_h;
+                    int y_end = (y_start + tile_h < height) ? y_start + tile_h : height;
+                    int x_start = tx * tile_w;
+                    int x_end = (x_start + tile_w < width) ? x_start + tile_w : width;
+
+                    for (int y = y_start; y < y_end; y++) {
+                        for (int x = x_start; x < x_end; x++) {
+                            for (int c = 0; c < channels; c++) {
+                                float sum = 0.0f;
+
+                                for (int ky = 0; ky < kernel_size; ky++) {
+                                    for (int kx = 0; kx < kernel_size; kx++) {
+                                        int img_y = y + ky - half_kernel;
+                                        int img_x = x + kx - half_kernel;
+
+                                        if (img_y >= 0 && img_y < height && img_x >= 0 && img_x < width) {
+                                            int idx = (img_y * width + img_x) * channels + c;
+                                            sum += input->data[idx] * kernel[ky][kx];
+                                        }
                                     }
                                 }
-                            }
 
-                            int out_idx = (y * width + x) * channels + c;
-                            output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
+                                int out_idx = (y * width + x) * channels + c;
+                                output->data[out_idx] = (uint8_t)fmin(fmax(sum, 0.0f), 255.0f);
+                            }
                         }
                     }
                 }
             }
         }
     }
+    return 1;
+}
+
+// Direct engine dispatch shared by convolve mode, batch mode, the autotuner and the MPI
+// driver: the per-node input replicas when given (--numa replicate), the recursive engine
+// when `recursive` is set (-e recursive), otherwise tiled when a tile size is configured.
+// Returns 0 if the engine fails (it reports why); output is then not fully written.
+int convolve_direct(Image* input, Image* output, float** kernel, int kernel_size, int recursive,
+                    ImageReplicas* replicas, ConvConfig* config) {
+    if (replicas) {
+        return convolve_openmp_replicated(replicas, output, kernel, kernel_size, config);
+    } else if (recursive) {
+        convolve_openmp_recursive(input, output, kernel, kernel_size, config);
+        return 1;
+    } else if (config->tile_size > 0) {
+        return convolve_openmp_tiled(input, output, kernel, kernel_size, config);
+    }
+    return convolve_openmp(input, output, kernel, kernel_size, config);
 }
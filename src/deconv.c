@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Guards the divisions against empty (zero) neighborhoods
+#define DECONV_EPSILON 1e-6f
+
+// Relative tolerance for treating a PSF as rank-1
+#define SEPARABLE_TOLERANCE 1e-5f
+
+// Load a square, odd-sized PSF from an image (channel 0), normalized to sum 1
+float** load_psf(const char* filename, int* size) {
+    Image* img = load_image(filename);
+    if (!img) return NULL;
+
+    if (img->width != img->height || img->width % 2 == 0) {
+        fprintf(stderr, "PSF must be square with an odd size (got %dx%d)\n", img->width, img->height);
+        free_image(img);
+        return NULL;
+    }
+
+    *size = img->width;
+    float** kernel = create_kernel(*size);
+    float* row = (float*)malloc((size_t)img->width * img->channels * sizeof(float));
+    if (!kernel || !row) {
+        free_kernel(kernel, *size);
+        free(row);
+        free_image(img);
+        return NULL;
+    }
+
+    double sum = 0.0;
+    for (int y = 0; y < *size; y++) {
+        load_row_float(img, (long)y * img->width * img->channels, row, (long)img->width * img->channels);
+        for (int x = 0; x < *size; x++) {
+            kernel[y][x] = row[x * img->channels];
+            sum += kernel[y][x];
+        }
+    }
+
+    if (sum <= 0.0) {
+        fprintf(stderr, "PSF has no positive weight\n");
+        free_kernel(kernel, *size);
+        kernel = NULL;
+    } else {
+        for (int y = 0; y < *size; y++) {
+            for (int x = 0; x < *size; x++) {
+                kernel[y][x] = (float)(kernel[y][x] / sum);
+            }
+        }
+    }
+
+    free(row);
+    free_image(img);
+    return kernel;
+}
+
+// Prepare a PSF and its 180-degree rotation; rank-1 PSFs also get 1-D factors
+PreparedPSF* prepare_psf(float** kernel, int size) {
+    PreparedPSF* psf = (PreparedPSF*)calloc(1, sizeof(PreparedPSF));
+    if (!psf) return NULL;
+
+    psf->size = size;
+    psf->kernel = create_kernel(size);
+    psf->flipped = create_kernel(size);
+    if (!psf->kernel || !psf->flipped) {
+        free_prepared_psf(psf);
+        return NULL;
+    }
+
+    int peak_y = 0, peak_x = 0;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            psf->kernel[y][x] = kernel[y][x];
+            psf->flipped[size - 1 - y][size - 1 - x] = kernel[y][x];
+            if (fabsf(kernel[y][x]) > fabsf(kernel[peak_y][peak_x])) {
+                peak_y = y;
+                peak_x = x;
+            }
+        }
+    }
+
+    // Rank-1 test: K == col (x) row with col = K[:, peak_x], row = K[peak_y, :] / peak
+    float peak = kernel[peak_y][peak_x];
+    psf->col_taps = (float*)malloc(4 * size * sizeof(float));
+    if (!psf->col_taps || peak == 0.0f) return psf;
+    psf->row_taps = psf->col_taps + size;
+    psf->col_flipped = psf->col_taps + 2 * size;
+    psf->row_flipped = psf->col_taps + 3 * size;
+
+    for (int i = 0; i < size; i++) {
+        psf->col_taps[i] = kernel[i][peak_x];
+        psf->row_taps[i] = kernel[peak_y][i] / peak;
+        psf->col_flipped[size - 1 - i] = psf->col_taps[i];
+        psf->row_flipped[size - 1 - i] = psf->row_taps[i];
+    }
+
+    float max_error = 0.0f;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float e = fabsf(kernel[y][x] - psf->col_taps[y] * psf->row_taps[x]);
+            if (e > max_error) max_error = e;
+        }
+    }
+    psf->separable = max_error <= SEPARABLE_TOLERANCE * fabsf(peak);
+
+    return psf;
+}
+
+void free_prepared_psf(PreparedPSF* psf) {
+    if (psf) {
+        free_kernel(psf->kernel, psf->size);
+        free_kernel(psf->flipped, psf->size);
+        free(psf->col_taps);
+        free(psf);
+    }
+}
+
+// Correlate in with the PSF (adjoint) or its flip (forward blur) on the fastest path
+static void apply_psf(PreparedPSF* psf, int flipped, Image* in, Image* out, Image* scratch,
+                      ConvConfig* config) {
+    if (psf->separable) {
+        convolve_separable_xy(in, out, flipped ? psf->row_flipped : psf->row_taps,
+                              flipped ? psf->col_flipped : psf->col_taps, psf->size, config, scratch);
+    } else {
+        convolve_openmp(in, out, flipped ? psf->flipped : psf->kernel, psf->size, config);
+    }
+}
+
+// Richardson-Lucy: est <- est * (K^T * (obs / (K * est))) / (K^T * 1).
+// The K^T * 1 term corrects for the zero-padded borders. All buffers are allocated once.
+int deconvolve_richardson_lucy(Image* input, Image* output, PreparedPSF* psf, int iterations,
+                               ConvConfig* config, DeconvStats* stats) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    long n = (long)width * height * channels;
+
+    Image* observed = create_image_typed(width, height, channels, PIXEL_F32);
+    Image* estimate = create_image_typed(width, height, channels, PIXEL_F32);
+    Image* blurred = create_image_typed(width, height, channels, PIXEL_F32);
+    Image* correction = create_image_typed(width, height, channels, PIXEL_F32);
+    Image* norm = create_image_typed(width, height, channels, PIXEL_F32);
+    // FP32 intermediates regardless of config: iterating would compound FP16 rounding
+    Image* scratch = psf->separable ? create_image_typed(width, height, channels, PIXEL_F32) : NULL;
+    if (!observed || !estimate || !blurred || !correction || !norm || (psf->separable && !scratch)) {
+        free_image(observed);
+        free_image(estimate);
+        free_image(blurred);
+        free_image(correction);
+        free_image(norm);
+        free_image(scratch);
+        return 0;
+    }
+
+    float* obs = IMAGE_F32(observed);
+    float* est = IMAGE_F32(estimate);
+    float* blur = IMAGE_F32(blurred);
+    float* corr = IMAGE_F32(correction);
+    float* nrm = IMAGE_F32(norm);
+
+    omp_set_num_threads(config->num_threads);
+
+    long row_len = (long)width * channels;
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; y++) {
+        load_row_float(input, y * row_len, obs + y * row_len, row_len);
+        memcpy(est + y * row_len, obs + y * row_len, row_len * sizeof(float));
+        for (long i = 0; i < row_len; i++) blur[y * row_len + i] = 1.0f;
+    }
+    apply_psf(psf, 0, blurred, norm, scratch, config);
+
+    double start_time = get_time();
+    for (int it = 0; it < iterations; it++) {
+        apply_psf(psf, 1, estimate, blurred, scratch, config);
+
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; i++) {
+            blur[i] = obs[i] / fmaxf(blur[i], DECONV_EPSILON);
+        }
+
+        apply_psf(psf, 0, blurred, correction, scratch, config);
+
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; i++) {
+            est[i] *= corr[i] / fmaxf(nrm[i], DECONV_EPSILON);
+        }
+    }
+    double elapsed = get_time() - start_time;
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; y++) {
+        store_row_float(est + y * row_len, output, y * row_len, row_len);
+    }
+
+    if (stats) {
+        stats->iterations = iterations;
+        stats->total_time = elapsed;
+        stats->time_per_iteration = iterations > 0 ? elapsed / iterations : 0.0;
+    }
+
+    free_image(observed);
+    free_image(estimate);
+    free_image(blurred);
+    free_image(correction);
+    free_image(norm);
+    free_image(scratch);
+    return 1;
+}
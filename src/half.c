@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "convolution.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_F16C_PATH 1
+#endif
+
+// Largest finite half-precision value; larger inputs saturate instead of becoming inf
+#define HALF_MAX 65504.0f
+
+// Scalar float -> half with round-to-nearest-even
+static uint16_t float_to_half_scalar(float value) {
+    union { float f; uint32_t u; } in;
+    in.f = fminf(fmaxf(value, -HALF_MAX), HALF_MAX);
+
+    uint32_t sign = (in.u >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((in.u >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = in.u & 0x7fffff;
+
+    if (exponent <= 0) {
+        // Subnormal half (or zero)
+        if (exponent < -10) return (uint16_t)sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return (uint16_t)(sign | half);
+}
+
+// Scalar half -> float
+static float half_to_float_scalar(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    union { float f; uint32_t u; } out;
+
+    if (exponent == 0) {
+        // Zero or subnormal: mantissa * 2^-24
+        out.f = ldexpf((float)mantissa, -24);
+        out.u |= sign;
+    } else if (exponent == 31) {
+        out.u = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        out.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    return out.f;
+}
+
+#ifdef HAVE_F16C_PATH
+static int has_f16c(void) {
+    static int cached = -1;
+    if (cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("f16c") && __builtin_cpu_supports("avx");
+    }
+    return cached;
+}
+
+__attribute__((target("avx,f16c")))
+static long float_to_half_f16c(const float* src, uint16_t* dst, long n) {
+    const __m256 lo = _mm256_set1_ps(-HALF_MAX);
+    const __m256 hi = _mm256_set1_ps(HALF_MAX);
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), lo), hi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c")))
+static long half_to_float_f16c(const uint16_t* src, float* dst, long n) {
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c")))
+static long accumulate_half_f16c(float* acc, const uint16_t* src, float weight, long n) {
+    const __m256 w = _mm256_set1_ps(weight);
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i)));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(w, v)));
+    }
+    return i;
+}
+#endif
+
+// Convert n floats to half precision
+void float_to_half_row(const float* src, uint16_t* dst, long n) {
+    long i = 0;
+#ifdef HAVE_F16C_PATH
+    if (has_f16c()) i = float_to_half_f16c(src, dst, n);
+#endif
+    for (; i < n; i++) {
+        dst[i] = float_to_half_scalar(src[i]);
+    }
+}
+
+// Convert n half-precision values to float
+void half_to_float_row(const uint16_t* src, float* dst, long n) {
+    long i = 0;
+#ifdef HAVE_F16C_PATH
+    if (has_f16c()) i = half_to_float_f16c(src, dst, n);
+#endif
+    for (; i < n; i++) {
+        dst[i] = half_to_float_scalar(src[i]);
+    }
+}
+
+// acc[i] += weight * src[i] for half-precision src
+void accumulate_half_row(float* acc, const uint16_t* src, float weight, long n) {
+    long i = 0;
+#ifdef HAVE_F16C_PATH
+    if (has_f16c()) i = accumulate_half_f16c(acc, src, weight, n);
+#endif
+    for (; i < n; i++) {
+        acc[i] += weight * half_to_float_scalar(src[i]);
+    }
+}
@@ -10,7 +10,7 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-// Load image from file
+// Load image from file; 16-bit and HDR files keep their precision
 Image* load_image(const char* filename) {
     Image* img = (Image*)malloc(sizeof(Image));
     if (!img) {
@@ -18,7 +18,16 @@ Image* load_image(const char* filename) {
         return NULL;
     }
 
-    img->data = stbi_load(filename, &img->width, &img->height, &img->channels, 0);
+    if (stbi_is_hdr(filename)) {
+        img->type = PIXEL_F32;
+        img->data = (uint8_t*)stbi_loadf(filename, &img->width, &img->height, &img->channels, 0);
+    } else if (stbi_is_16_bit(filename)) {
+        img->type = PIXEL_U16;
+        img->data = (uint8_t*)stbi_load_16(filename, &img->width, &img->height, &img->channels, 0);
+    } else {
+        img->type = PIXEL_U8;
+        img->data = stbi_load(filename, &img->width, &img->height, &img->channels, 0);
+    }
     
     if (!img->data) {
         fprintf(stderr, "Failed to load image: %s\n", filename);
@@ -27,12 +36,58 @@ Image* load_image(const char* filename) {
         return NULL;
     }
 
-    printf("Loaded image: %s (%dx%d, %d channels)\n", 
-           filename, img->width, img->height, img->channels);
+    // stb_image returns 16-bit PNM samples in file (big-endian) byte order
+    const char* ext = strrchr(filename, '.');
+    if (img->type == PIXEL_U16 && ext &&
+        (strcmp(ext, ".pgm") == 0 || strcmp(ext, ".ppm") == 0 || strcmp(ext, ".pnm") == 0 ||
+         strcmp(ext, ".PGM") == 0 || strcmp(ext, ".PPM") == 0 || strcmp(ext, ".PNM") == 0)) {
+        uint16_t probe = 1;
+        if (*(uint8_t*)&probe == 1) {
+            uint16_t* samples = IMAGE_U16(img);
+            long n = (long)img->width * img->height * img->channels;
+            for (long i = 0; i < n; i++) {
+                samples[i] = (uint16_t)((samples[i] << 8) | (samples[i] >> 8));
+            }
+        }
+    }
+
+    printf("Loaded image: %s (%dx%d, %d channels, %s)\n", 
+           filename, img->width, img->height, img->channels, pixel_type_name(img->type));
     
     return img;
 }
 
+// Write binary PGM/PPM, 16 bits per sample for PIXEL_U16 and 8 bits otherwise
+static int write_pnm(const char* filename, Image* img) {
+    if (img->channels != 1 && img->channels != 3) {
+        fprintf(stderr, "PNM output requires 1 or 3 channels\n");
+        return 0;
+    }
+
+    FILE* f = fopen(filename, "wb");
+    if (!f) return 0;
+
+    int wide = img->type == PIXEL_U16;
+    fprintf(f, "P%d\n%d %d\n%d\n", img->channels == 1 ? 5 : 6,
+            img->width, img->height, wide ? 65535 : 255);
+
+    long n = (long)img->width * img->height * img->channels;
+    int ok = 1;
+    if (wide) {
+        // PNM stores 16-bit samples big-endian
+        uint16_t* src = IMAGE_U16(img);
+        for (long i = 0; i < n && ok; i++) {
+            uint8_t be[2] = {(uint8_t)(src[i] >> 8), (uint8_t)(src[i] & 0xff)};
+            ok = fwrite(be, 1, 2, f) == 2;
+        }
+    } else {
+        ok = fwrite(img->data, 1, n, f) == (size_t)n;
+    }
+
+    fclose(f);
+    return ok;
+}
+
 // Save image to file
 int save_image(const char* filename, Image* img) {
     if (!img || !img->data) {
@@ -44,20 +99,45 @@ int save_image(const char* filename, Image* img) {
     const char* ext = strrchr(filename, '.');
     
     if (ext) {
-        if (strcmp(ext, ".png") == 0 || strcmp(ext, ".PNG") == 0) {
-            result = stbi_write_png(filename, img->width, img->height, 
-                                   img->channels, img->data, 
-                                   img->width * img->channels);
-        } else if (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".JPG") == 0 ||
-                   strcmp(ext, ".jpeg") == 0 || strcmp(ext, ".JPEG") == 0) {
-            result = stbi_write_jpg(filename, img->width, img->height, 
-                                   img->channels, img->data, 90);
-        } else if (strcmp(ext, ".bmp") == 0 || strcmp(ext, ".BMP") == 0) {
-            result = stbi_write_bmp(filename, img->width, img->height, 
-                                   img->channels, img->data);
+        if (strcmp(ext, ".hdr") == 0 || strcmp(ext, ".HDR") == 0) {
+            Image* f32 = img->type == PIXEL_F32 ? img : convert_image(img, PIXEL_F32);
+            if (f32) {
+                result = stbi_write_hdr(filename, f32->width, f32->height, f32->channels, IMAGE_F32(f32));
+                if (f32 != img) free_image(f32);
+            }
+        } else if (strcmp(ext, ".pgm") == 0 || strcmp(ext, ".ppm") == 0 ||
+                   strcmp(ext, ".PGM") == 0 || strcmp(ext, ".PPM") == 0) {
+            Image* pnm = img->type == PIXEL_F32 ? convert_image(img, PIXEL_U16) : img;
+            if (pnm) {
+                result = write_pnm(filename, pnm);
+                if (pnm != img) free_image(pnm);
+            }
         } else {
-            fprintf(stderr, "Unsupported file format: %s\n", ext);
-            return 0;
+            // PNG, JPEG and BMP writers only take 8-bit samples
+            Image* u8 = img->type == PIXEL_U8 ? img : convert_image(img, PIXEL_U8);
+            if (!u8) return 0;
+
+            if (strcmp(ext, ".png") == 0 || strcmp(ext, ".PNG") == 0) {
+                result = stbi_write_png(filename, u8->width, u8->height, 
+                                       u8->channels, u8->data, 
+                                       u8->width * u8->channels);
+            } else if (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".JPG") == 0 ||
+                       strcmp(ext, ".jpeg") == 0 || strcmp(ext, ".JPEG") == 0) {
+                result = stbi_write_jpg(filename, u8->width, u8->height, 
+                                       u8->channels, u8->data, 90);
+            } else if (strcmp(ext, ".bmp") == 0 || strcmp(ext, ".BMP") == 0) {
+                result = stbi_write_bmp(filename, u8->width, u8->height, 
+                                       u8->channels, u8->data);
+            } else {
+                fprintf(stderr, "Unsupported file format: %s\n", ext);
+                if (u8 != img) free_image(u8);
+                return 0;
+            }
+
+            if (u8 != img) {
+                printf("Note: %s samples written as 8-bit\n", pixel_type_name(img->type));
+                free_image(u8);
+            }
         }
     }
 
@@ -80,8 +160,40 @@ void free_image(Image* img) {
     }
 }
 
+// Bytes per sample
+int pixel_size(PixelType type) {
+    switch (type) {
+        case PIXEL_U16: return 2;
+        case PIXEL_F16: return 2;
+        case PIXEL_F32: return 4;
+        default:        return 1;
+    }
+}
+
+// Parse a pixel type name; returns -1 if unknown
+int parse_pixel_type(const char* name) {
+    if (strcmp(name, "u8") == 0) return PIXEL_U8;
+    if (strcmp(name, "u16") == 0) return PIXEL_U16;
+    if (strcmp(name, "f32") == 0) return PIXEL_F32;
+    return -1;
+}
+
+const char* pixel_type_name(PixelType type) {
+    switch (type) {
+        case PIXEL_U16: return "u16";
+        case PIXEL_F16: return "f16";
+        case PIXEL_F32: return "f32";
+        default:        return "u8";
+    }
+}
+
 // Create empty image
 Image* create_image(int width, int height, int channels) {
+    return create_image_typed(width, height, channels, PIXEL_U8);
+}
+
+// Create empty image with the given sample type
+Image* create_image_typed(int width, int height, int channels, PixelType type) {
     Image* img = (Image*)malloc(sizeof(Image));
     if (!img) {
         fprintf(stderr, "Failed to allocate memory for image structure\n");
@@ -91,7 +203,8 @@ Image* create_image(int width, int height, int channels) {
     img->width = width;
     img->height = height;
     img->channels = channels;
-    img->data = (uint8_t*)calloc(width * height * channels, sizeof(uint8_t));
+    img->type = type;
+    img->data = (uint8_t*)calloc((size_t)width * height * channels, pixel_size(type));
 
     if (!img->data) {
         fprintf(stderr, "Failed to allocate memory for image data\n");
@@ -102,6 +215,177 @@ Image* create_image(int width, int height, int channels) {
     return img;
 }
 
+// Convert to another sample type. Integer types map to [0, 1] in f32; u8 <-> u16 scales by 257.
+Image* convert_image(Image* src, PixelType type) {
+    FloatImage* f = image_to_float(src);
+    if (!f) return NULL;
+
+    static const float range[] = {255.0f, 65535.0f, 1.0f, 1.0f};
+    float scale = range[type] / range[src->type];
+    long n = (long)f->width * f->height * f->channels;
+    if (scale != 1.0f) {
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; i++) {
+            f->data[i] *= scale;
+        }
+    }
+
+    Image* dst = create_image_typed(src->width, src->height, src->channels, type);
+    if (dst) float_to_image(f, dst);
+    free_float_image(f);
+    return dst;
+}
+
+// Create empty floating-point image
+FloatImage* create_float_image(int width, int height, int channels) {
+    FloatImage* img = (FloatImage*)malloc(sizeof(FloatImage));
+    if (!img) {
+        fprintf(stderr, "Failed to allocate memory for float image structure\n");
+        return NULL;
+    }
+
+    img->width = width;
+    img->height = height;
+    img->channels = channels;
+    img->data = (float*)calloc((size_t)width * height * channels, sizeof(float));
+
+    if (!img->data) {
+        fprintf(stderr, "Failed to allocate memory for float image data\n");
+        free(img);
+        return NULL;
+    }
+
+    return img;
+}
+
+// Free floating-point image memory
+void free_float_image(FloatImage* img) {
+    if (img) {
+        free(img->data);
+        free(img);
+    }
+}
+
+// Convert n samples starting at offset to float (values keep their native range)
+void load_row_float(const Image* img, long offset, float* dst, long n) {
+    switch (img->type) {
+        case PIXEL_F32:
+            memcpy(dst, IMAGE_F32(img) + offset, n * sizeof(float));
+            break;
+        case PIXEL_F16:
+            half_to_float_row(IMAGE_U16(img) + offset, dst, n);
+            break;
+        case PIXEL_U16: {
+            const uint16_t* src = IMAGE_U16(img) + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) dst[i] = (float)src[i];
+            break;
+        }
+        default: {
+            const uint8_t* src = img->data + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) dst[i] = (float)src[i];
+            break;
+        }
+    }
+}
+
+// Store n floats at offset, rounding and clamping for integer types
+void store_row_float(const float* src, Image* img, long offset, long n) {
+    switch (img->type) {
+        case PIXEL_F32:
+            memcpy(IMAGE_F32(img) + offset, src, n * sizeof(float));
+            break;
+        case PIXEL_F16:
+            float_to_half_row(src, IMAGE_U16(img) + offset, n);
+            break;
+        case PIXEL_U16: {
+            uint16_t* dst = IMAGE_U16(img) + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) dst[i] = (uint16_t)fminf(fmaxf(src[i] + 0.5f, 0.0f), 65535.0f);
+            break;
+        }
+        default: {
+            uint8_t* dst = img->data + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) dst[i] = (uint8_t)fminf(fmaxf(src[i] + 0.5f, 0.0f), 255.0f);
+            break;
+        }
+    }
+}
+
+// Same as store_row_float, but integer types are clamped and truncated like the direct
+// engine's stores, so engines that are compared against it round the same way
+void store_row_truncate(const float* src, Image* img, long offset, long n) {
+    switch (img->type) {
+        case PIXEL_U16: {
+            uint16_t* dst = IMAGE_U16(img) + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) dst[i] = (uint16_t)fminf(fmaxf(src[i], 0.0f), 65535.0f);
+            break;
+        }
+        case PIXEL_U8: {
+            uint8_t* dst = img->data + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) dst[i] = (uint8_t)fminf(fmaxf(src[i], 0.0f), 255.0f);
+            break;
+        }
+        default:
+            store_row_float(src, img, offset, n);
+            break;
+    }
+}
+
+// acc[i] += weight * sample[offset + i]
+void accumulate_row(float* acc, const Image* img, long offset, float weight, long n) {
+    switch (img->type) {
+        case PIXEL_F32: {
+            const float* src = IMAGE_F32(img) + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) acc[i] += weight * src[i];
+            break;
+        }
+        case PIXEL_F16:
+            accumulate_half_row(acc, IMAGE_U16(img) + offset, weight, n);
+            break;
+        case PIXEL_U16: {
+            const uint16_t* src = IMAGE_U16(img) + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) acc[i] += weight * src[i];
+            break;
+        }
+        default: {
+            const uint8_t* src = img->data + offset;
+            #pragma omp simd
+            for (long i = 0; i < n; i++) acc[i] += weight * src[i];
+            break;
+        }
+    }
+}
+
+// Convert image samples to floating point (values keep their native range)
+FloatImage* image_to_float(Image* img) {
+    FloatImage* out = create_float_image(img->width, img->height, img->channels);
+    if (!out) return NULL;
+
+    long row_len = (long)img->width * img->channels;
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < img->height; y++) {
+        load_row_float(img, y * row_len, out->data + y * row_len, row_len);
+    }
+
+    return out;
+}
+
+// Store floating-point samples into dst, rounding and clamping for integer types
+void float_to_image(FloatImage* src, Image* dst) {
+    long row_len = (long)src->width * src->channels;
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < src->height; y++) {
+        store_row_float(src->data + y * row_len, dst, y * row_len, row_len);
+    }
+}
+
 // Create kernel matrix
 float** create_kernel(int size) {
     float** kernel = (float**)malloc(size * sizeof(float*));
@@ -179,6 +463,104 @@ float** create_box_kernel(int size) {
     return kernel;
 }
 
+// Create ring kernel: equal weights on the one-pixel-wide circle of radius size/2
+float** create_ring_kernel(int size) {
+    float** kernel = create_kernel(size);
+    if (!kernel) return NULL;
+
+    int center = size / 2;
+    int count = 0;
+
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            float r = sqrtf((float)((i - center) * (i - center) + (j - center) * (j - center)));
+            if (fabsf(r - center) < 0.5f) {
+                kernel[i][j] = 1.0f;
+                count++;
+            }
+        }
+    }
+
+    // A 1x1 ring is the identity
+    if (count == 0) {
+        kernel[center][center] = 1.0f;
+        count = 1;
+    }
+
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            kernel[i][j] /= count;
+        }
+    }
+
+    return kernel;
+}
+
+// Create line (motion blur) kernel: equal weights along a centered line at angle degrees
+float** create_line_kernel(int size, float angle) {
+    float** kernel = create_kernel(size);
+    if (!kernel) return NULL;
+
+    int center = size / 2;
+    float dx = cosf(angle * (float)M_PI / 180.0f);
+    float dy = -sinf(angle * (float)M_PI / 180.0f);
+    int count = 0;
+
+    for (int t = -center; t <= center; t++) {
+        int i = center + (int)lroundf(t * dy);
+        int j = center + (int)lroundf(t * dx);
+        if (kernel[i][j] == 0.0f) {
+            kernel[i][j] = 1.0f;
+            count++;
+        }
+    }
+
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            kernel[i][j] /= count;
+        }
+    }
+
+    return kernel;
+}
+
+// Create normalized 1-D Gaussian taps; their outer product equals create_gaussian_kernel
+float* create_gaussian_taps(int size, float sigma) {
+    float* taps = (float*)malloc(size * sizeof(float));
+    if (!taps) {
+        fprintf(stderr, "Failed to allocate memory for kernel taps\n");
+        return NULL;
+    }
+
+    float sum = 0.0f;
+    int center = size / 2;
+    for (int i = 0; i < size; i++) {
+        int x = i - center;
+        taps[i] = exp(-(x * x) / (2.0f * sigma * sigma));
+        sum += taps[i];
+    }
+    for (int i = 0; i < size; i++) {
+        taps[i] /= sum;
+    }
+
+    return taps;
+}
+
+// Create 1-D box taps
+float* create_box_taps(int size) {
+    float* taps = (float*)malloc(size * sizeof(float));
+    if (!taps) {
+        fprintf(stderr, "Failed to allocate memory for kernel taps\n");
+        return NULL;
+    }
+
+    for (int i = 0; i < size; i++) {
+        taps[i] = 1.0f / size;
+    }
+
+    return taps;
+}
+
 // Print kernel values
 void print_kernel(float** kernel, int size) {
     printf("Kernel (%dx%d):\n", size, size);
@@ -196,7 +578,13 @@ void print_config(ConvConfig* config) {
     printf("  Threads: %d\n", config->num_threads);
     printf("  Schedule: %s\n", config->schedule_type);
     printf("  Chunk size: %d\n", config->chunk_size);
-    printf("  Tile size: %d%s\n", config->tile_size, 
-           config->tile_size == 0 ? " (no tiling)" : "");
+    if (config->tile_width > 0 && config->tile_size > 0) {
+        printf("  Tile size: %dx%d\n", config->tile_width, config->tile_size);
+    } else {
+        printf("  Tile size: %d%s\n", config->tile_size,
+               config->tile_size == 0 ? " (no tiling)" : "");
+    }
     printf("  Loop order: %s\n", config->loop_order == 0 ? "Y-first" : "X-first");
+    printf("  Intermediates: %s\n", config->half_intermediates ? "fp16" : "fp32");
+    printf("  Affinity: %s\n", config->affinity);
 }
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Output tile edge when no tile size is configured
+#define ITERATE_DEFAULT_TILE 128
+
+// Auto time block: the largest step count whose enlarged tile is at most this many times
+// the tile area (bounds the redundant halo work)
+#define ITERATE_MAX_OVERLAP 1.5
+
+// The direct engines' per-step stores: u8 and u16 truncate after clamping, f32 is exact
+static inline float quantize(float v, float max_value) {
+    return max_value > 0.0f ? floorf(fminf(fmaxf(v, 0.0f), max_value)) : v;
+}
+
+// Steps per time block for `-n iterations` when none is given
+int choose_time_block(int tile_w, int tile_h, int kernel_size, int iterations) {
+    int r = kernel_size / 2;
+    int steps = 1;
+    while (steps < iterations &&
+           (double)(tile_w + 2 * (steps + 1) * r) * (tile_h + 2 * (steps + 1) * r) <=
+               ITERATE_MAX_OVERLAP * tile_w * tile_h) {
+        steps++;
+    }
+    return steps;
+}
+
+// Advance one output tile by `steps` iterations entirely in two local float planes.
+// The plane covers the tile plus steps * r on every side; step t recomputes the part
+// that is still exact after t steps (the tile plus (steps - t) * r), so only the tile
+// itself is valid at the end. Positions outside the image hold 0 at every step, which
+// is the direct engine's zero padding, and each step is quantized like its stores.
+static void advance_tile(const Image* src, Image* dst, float** kernel, int kernel_size, int steps,
+                         int x0, int y0, int x1, int y1, float max_value, float* a, float* b) {
+    int width = src->width;
+    int height = src->height;
+    int channels = src->channels;
+    int r = kernel_size / 2;
+    int halo = steps * r;
+    int pw = x1 - x0 + 2 * halo;
+    int ph = y1 - y0 + 2 * halo;
+    long plane_row = (long)pw * channels;
+    long row_len = (long)width * channels;
+
+    // Load the enlarged tile, zero outside the image
+    memset(a, 0, (size_t)ph * plane_row * sizeof(float));
+    memset(b, 0, (size_t)ph * plane_row * sizeof(float));
+    int gx0 = x0 - halo < 0 ? 0 : x0 - halo;
+    int gx1 = x1 + halo > width ? width : x1 + halo;
+    for (int j = 0; j < ph; j++) {
+        int gy = y0 - halo + j;
+        if (gy < 0 || gy >= height || gx1 <= gx0) continue;
+        load_row_float(src, gy * row_len + (long)gx0 * channels,
+                       a + j * plane_row + (long)(gx0 - (x0 - halo)) * channels, (long)(gx1 - gx0) * channels);
+    }
+
+    for (int t = 1; t <= steps; t++) {
+        // Still-exact region after this step, in plane coordinates, clipped to the image
+        int m = t * r;
+        int jy0 = m, jy1 = ph - m;
+        int ix0 = m, ix1 = pw - m;
+        if (y0 - halo + jy0 < 0) jy0 = halo - y0;
+        if (y0 - halo + jy1 > height) jy1 = height - (y0 - halo);
+        if (x0 - halo + ix0 < 0) ix0 = halo - x0;
+        if (x0 - halo + ix1 > width) ix1 = width - (x0 - halo);
+
+        for (int j = jy0; j < jy1; j++) {
+            for (int i = ix0; i < ix1; i++) {
+                for (int c = 0; c < channels; c++) {
+                    float sum = 0.0f;
+                    for (int ky = 0; ky < kernel_size; ky++) {
+                        const float* s = a + (long)(j + ky - r) * plane_row + (long)(i - r) * channels + c;
+                        for (int kx = 0; kx < kernel_size; kx++) {
+                            sum += s[(long)kx * channels] * kernel[ky][kx];
+                        }
+                    }
+                    b[j * plane_row + (long)i * channels + c] = quantize(sum, max_value);
+                }
+            }
+        }
+
+        float* swap = a;
+        a = b;
+        b = swap;
+    }
+
+    // Values are already quantized, so the store's rounding is exact
+    for (int y = y0; y < y1; y++) {
+        store_row_float(a + (long)(y - y0 + halo) * plane_row + (long)halo * channels, dst,
+                        y * row_len + (long)x0 * channels, (long)(x1 - x0) * channels);
+    }
+}
+
+// Apply the kernel `iterations` times with temporal blocking. Each sweep over the image
+// advances every tile by up to time_block steps in cache (overlapped tiling: a tile is
+// loaded with a time_block * r halo and the redundant halo work is repeated by its
+// neighbours), so the image makes ceil(iterations / time_block) round trips through
+// memory instead of `iterations`. The result equals `iterations` runs of the direct
+// engine, truncation included. time_block 0 picks the largest block whose enlarged
+// tile stays within ITERATE_MAX_OVERLAP of the tile area.
+int convolve_iterated(Image* input, Image* output, float** kernel, int kernel_size, int iterations, int time_block,
+                      ConvConfig* config, IterateStats* stats) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    int tile_h = config->tile_size > 0 ? config->tile_size : ITERATE_DEFAULT_TILE;
+    int tile_w = config->tile_width > 0 ? config->tile_width : tile_h;
+    int r = kernel_size / 2;
+    float max_value = input->type == PIXEL_U8 ? 255.0f : input->type == PIXEL_U16 ? 65535.0f : 0.0f;
+
+    if (iterations < 1) iterations = 1;
+    if (time_block <= 0) time_block = choose_time_block(tile_w, tile_h, kernel_size, iterations);
+    if (time_block > iterations) time_block = iterations;
+
+    int sweeps = (iterations + time_block - 1) / time_block;
+    int tiles_x = (width + tile_w - 1) / tile_w;
+    int num_tiles = tiles_x * ((height + tile_h - 1) / tile_h);
+    long plane_len = (long)(tile_w + 2 * time_block * r) * (tile_h + 2 * time_block * r) * channels;
+
+    // Sweeps alternate between two scratch images; the last one writes output
+    Image* scratch[2] = {NULL, NULL};
+    for (int k = 0; k < 2 && k < sweeps - 1; k++) {
+        scratch[k] = create_image_typed(width, height, channels, input->type);
+        if (!scratch[k]) {
+            fprintf(stderr, "Failed to allocate temporal blocking buffers\n");
+            free_image(scratch[0]);
+            return 0;
+        }
+    }
+
+    omp_set_num_threads(config->num_threads);
+
+    Image* src = input;
+    int done = 0;
+    int failed = 0;
+    for (int sweep = 0; sweep < sweeps && !failed; sweep++) {
+        int steps = iterations - done < time_block ? iterations - done : time_block;
+        Image* dst = sweep == sweeps - 1 ? output : scratch[sweep % 2];
+
+        #pragma omp parallel reduction(+:failed)
+        {
+            float* a = (float*)malloc(plane_len * sizeof(float));
+            float* b = (float*)malloc(plane_len * sizeof(float));
+            int ok = a && b;
+            failed += !ok;
+
+            #pragma omp for schedule(dynamic, config->chunk_size)
+            for (int i = 0; i < num_tiles; i++) {
+                if (!ok) continue;
+                int x0 = (i % tiles_x) * tile_w;
+                int y0 = (i / tiles_x) * tile_h;
+                int x1 = x0 + tile_w < width ? x0 + tile_w : width;
+                int y1 = y0 + tile_h < height ? y0 + tile_h : height;
+                advance_tile(src, dst, kernel, kernel_size, steps, x0, y0, x1, y1, max_value, a, b);
+            }
+
+            free(a);
+            free(b);
+        }
+
+        done += steps;
+        src = dst;
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to allocate temporal blocking tile planes\n");
+        free_image(scratch[0]);
+        free_image(scratch[1]);
+        return 0;
+    }
+
+    if (stats) {
+        stats->iterations = iterations;
+        stats->time_block = time_block;
+        stats->sweeps = sweeps;
+        stats->tiles = num_tiles;
+        stats->tile_w = tile_w;
+        stats->tile_h = tile_h;
+    }
+
+    free_image(scratch[0]);
+    free_image(scratch[1]);
+    return 1;
+}
@@ -1,25 +1,548 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <omp.h>
 #include "convolution.h"
 
 void print_usage(const char* prog_name) {
     printf("Usage: %s [options]\n", prog_name);
     printf("Options:\n");
-    printf("  -i <input>        Input image file (required)\n");
+    printf("  -i <input>        Input image file, or image list for volume, temporal and batch modes (required)\n");
     printf("  -o <output>       Output image file (required)\n");
     printf("  -k <size>         Kernel size (3 or 31, default: 3)\n");
-    printf("  -t <threads>      Number of threads (default: 4)\n");
-    printf("  -s <schedule>     Schedule type: static, dynamic, guided (default: static)\n");
+    printf("  -t <threads>      Number of threads, or auto from the work and the available CPUs (default: 4)\n");
+    printf("  -s <schedule>     Schedule type: static, dynamic, guided, steal, adaptive (default: static)\n");
     printf("  -c <chunk>        Chunk size (default: 1)\n");
-    printf("  -l <order>        Loop order: 0=Y-first, 1=X-first (default: 0)\n");
-    printf("  -T <tile>         Tile size: 0=no tiling, 8, 16 (default: 0)\n");
-    printf("  -f <filter>       Filter type: gaussian, box (default: gaussian)\n");
+    printf("  -l <order>        Loop order: 0=Y-first, 1=X-first over transposed buffers (default: 0)\n");
+    printf("  -T <tile>         Tile size: 0=no tiling, N for NxN, WxH, or auto from the cache sizes (default: 0)\n");
+    printf("  -f <filter>       Filter type: gaussian, box, ring, line (default: gaussian)\n");
+    printf("  -e <engine>       Convolution engine: direct, separable, sparse, recursive (default: direct)\n");
+    printf("  -d <dilation>     Kernel dilation for the sparse engine (default: 1)\n");
+    printf("  --angle <deg>     Line kernel angle in degrees (default: 0)\n");
+    printf("  -P <precision>    Multi-pass intermediates: fp32, fp16 (default: fp32)\n");
+    printf("  -m <mode>         Mode: convolve, laplacian, resize, varying, scalespace, deconv, atrous, volume, temporal, pipeline, batch (default: convolve)\n");
+    printf("  -L <levels>       Pyramid, scale-space or wavelet levels (default: 5)\n");
+    printf("  -g <gain>         Detail gain for laplacian and atrous modes (default: 1.0)\n");
+    printf("  -W <width>        Output width for resize mode\n");
+    printf("  -H <height>       Output height for resize mode (default: keep aspect ratio)\n");
+    printf("  -r <filter>       Resize filter: lanczos3, bicubic, area (default: lanczos3)\n");
+    printf("  -b <sigma>        Gaussian blur folded into the resize taps, in output pixels (default: 0)\n");
+    printf("  -M <map>          Sigma map image for varying mode, or 'vignette' (default: vignette)\n");
+    printf("  -x <sigma>        Sigma at the map's maximum value for varying mode (default: 8.0)\n");
+    printf("  -q <levels>       Quantized kernel levels for varying mode (default: 16)\n");
+    printf("  --sigma0 <sigma>  First scale-space sigma (default: 1.6)\n");
+    printf("  --ratio <k>       Sigma ratio between scale-space levels (default: 1.414)\n");
+    printf("  --stages <spec>   Pipeline stages, e.g. gaussian:5,sobel,threshold:64\n");
+    printf("  --exec <model>    Pipeline execution: persistent, regions, tasks, stream (default: persistent)\n");
+    printf("  -B <rows>         Pipeline band height in rows (default: 16)\n");
+    printf("  -N <frames>       Temporal window for temporal mode (default: 5)\n");
+    printf("  --inflight <n>    Images processed at once in batch mode, sharing -t threads (default: auto)\n");
+    printf("  -K <psf>          PSF image for deconv mode (default: the -f/-k kernel)\n");
+    printf("  -n <iterations>   Richardson-Lucy iterations for deconv mode (default: 20), or times to apply\n");
+    printf("                    the kernel in convolve mode (default: 1)\n");
+    printf("  --time-block <n>  Iterations advanced per tile per pass with -n (default: auto)\n");
+    printf("  -p <type>         Convert input samples to u8, u16 or f32 before processing\n");
+    printf("  -A <affinity>     Thread affinity: none, compact, scatter, core, or a CPU list like 0,2,4-7 (default: none)\n");
+    printf("  --numa <policy>   Page placement: off, first-touch, replicate (default: off)\n");
+    printf("  --autotune        Tune -t, -s, -c, -T and -l for this input and kernel, save to the wisdom file\n");
+    printf("  --wisdom <file>   Wisdom file (default: $CONV_WISDOM or ~/.convolution_wisdom, 'none' to disable)\n");
     printf("  -S                Run sequential (baseline) version\n");
     printf("  -h                Show this help message\n");
 }
 
+// Laplacian pyramid round trip with optional detail enhancement
+static int run_laplacian(Image* input, Image* output, int levels, float gain, ConvConfig* config) {
+    printf("\nRunning Laplacian pyramid decompose/reconstruct...\n");
+    printf("  Threads: %d\n", config->num_threads);
+    printf("  Levels: %d\n", levels);
+    printf("  Detail gain: %.3f\n\n", gain);
+
+    double start_time = get_time();
+    LaplacianPyramid* pyr = laplacian_decompose(input, levels, config);
+    if (!pyr) {
+        fprintf(stderr, "Failed to build Laplacian pyramid\n");
+        return 0;
+    }
+    double decompose_time = get_time() - start_time;
+
+    if (gain != 1.0f) {
+        laplacian_scale_details(pyr, gain, config);
+    }
+
+    start_time = get_time();
+    if (!laplacian_reconstruct(pyr, output, config)) {
+        fprintf(stderr, "Failed to reconstruct Laplacian pyramid\n");
+        free_laplacian_pyramid(pyr);
+        return 0;
+    }
+    double reconstruct_time = get_time() - start_time;
+
+    printf("Levels built: %d (residual %dx%d)\n", pyr->levels,
+           pyr->level[pyr->levels - 1]->width, pyr->level[pyr->levels - 1]->height);
+    printf("Decompose time: %.6f seconds\n", decompose_time);
+    printf("Reconstruct time: %.6f seconds\n", reconstruct_time);
+    printf("Parallel time: %.6f seconds\n", decompose_time + reconstruct_time);
+
+    free_laplacian_pyramid(pyr);
+    return 1;
+}
+
+// Resize with an optional blur folded into the resampling taps
+static int run_resize(Image* input, Image* output, ResizeFilter filter, const char* filter_name,
+                      float blur_sigma, ConvConfig* config) {
+    printf("\nRunning separable resize...\n");
+    printf("  Threads: %d\n", config->num_threads);
+    printf("  Size: %dx%d -> %dx%d\n", input->width, input->height, output->width, output->height);
+    printf("  Filter: %s\n", filter_name);
+    printf("  Folded blur sigma: %.3f\n\n", blur_sigma);
+
+    double start_time = get_time();
+    if (!resize_image(input, output, filter, blur_sigma, config)) {
+        fprintf(stderr, "Failed to resize image\n");
+        return 0;
+    }
+    double elapsed = get_time() - start_time;
+
+    printf("Parallel time: %.6f seconds\n", elapsed);
+    return 1;
+}
+
+// Spatially varying blur driven by a sigma map
+static int run_varying(Image* input, Image* output, const char* map_file, float max_sigma,
+                       int quant_levels, ConvConfig* config) {
+    Image* map;
+    if (strcmp(map_file, "vignette") == 0) {
+        map = create_vignette_map(input->width, input->height);
+    } else {
+        map = load_image(map_file);
+    }
+    if (!map) {
+        fprintf(stderr, "Failed to load sigma map: %s\n", map_file);
+        return 0;
+    }
+
+    printf("\nRunning spatially varying blur...\n");
+    printf("  Sigma map: %s (%dx%d)\n", map_file, map->width, map->height);
+    printf("  Max sigma: %.3f\n", max_sigma);
+    printf("  Kernel levels: %d\n", quant_levels);
+    print_config(config);
+    printf("\n");
+
+    VaryingStats stats;
+    double start_time = get_time();
+    convolve_varying(input, output, map, max_sigma, quant_levels, config, &stats);
+    double elapsed = get_time() - start_time;
+
+    printf("Tiles: %d, kernels used: %d, tile passes: %ld\n",
+           stats.tiles, stats.kernels_used, stats.tile_passes);
+    if (strcmp(config->schedule_type, "steal") == 0) {
+        printf("Tiles stolen: %ld\n", stats.steals);
+    }
+    printf("Parallel time: %.6f seconds\n", elapsed);
+
+    free_image(map);
+    return 1;
+}
+
+// Output path with a suffix inserted before the extension
+static void suffixed_path(char* dst, size_t size, const char* path, const char* suffix) {
+    const char* ext = strrchr(path, '.');
+    int stem = ext ? (int)(ext - path) : (int)strlen(path);
+    snprintf(dst, size, "%.*s%s%s", stem, path, suffix, ext ? ext : "");
+}
+
+typedef struct {
+    const char* output_file;
+    int levels;
+    int saved;
+    int failed;
+} ScaleSpaceOutput;
+
+static void save_scale_level(int is_dog, int index, float sigma, Image* img, void* user) {
+    ScaleSpaceOutput* out = (ScaleSpaceOutput*)user;
+    char suffix[32];
+    char path[1024];
+    snprintf(suffix, sizeof(suffix), is_dog ? "_dog%d" : "_g%d", index);
+    suffixed_path(path, sizeof(path), out->output_file, suffix);
+
+    printf("  %s %d (sigma %.3f): ", is_dog ? "DoG" : "Gaussian", index, sigma);
+    if (save_image(path, img)) {
+        out->saved++;
+    } else {
+        out->failed++;
+    }
+}
+
+// Gaussian and DoG stack built by incremental blurring
+static int run_scalespace(Image* input, const char* output_file, int levels, float sigma0,
+                          float ratio, ConvConfig* config) {
+    printf("\nRunning scale-space construction...\n");
+    printf("  Levels: %d\n", levels);
+    printf("  Sigma0: %.3f, ratio: %.3f\n", sigma0, ratio);
+    print_config(config);
+    printf("\n");
+
+    ScaleSpaceOutput out = {output_file, levels, 0, 0};
+    ScaleSpaceStats stats;
+    double start_time = get_time();
+    int ok = build_scale_space(input, levels, sigma0, ratio, config, save_scale_level, &out, &stats);
+    double elapsed = get_time() - start_time;
+    if (!ok || out.failed) {
+        fprintf(stderr, "Failed to build scale space\n");
+        return 0;
+    }
+
+    printf("\nImages written: %d\n", out.saved);
+    printf("Taps per pixel: %ld incremental vs %ld independent (%.2fx less work)\n",
+           stats.incremental_taps, stats.independent_taps,
+           (double)stats.independent_taps / stats.incremental_taps);
+    printf("Blur time: %.6f seconds\n", stats.blur_time);
+    printf("Total time (including writes): %.6f seconds\n", elapsed);
+    return 1;
+}
+
+static void save_atrous_plane(int index, Image* img, void* user) {
+    ScaleSpaceOutput* out = (ScaleSpaceOutput*)user;
+    char suffix[32];
+    char path[1024];
+    snprintf(suffix, sizeof(suffix), index < out->levels ? "_w%d" : "_c%d", index);
+    suffixed_path(path, sizeof(path), out->output_file, suffix);
+
+    printf("  %s %d: ", index < out->levels ? "Detail" : "Residual", index);
+    if (save_image(path, img)) {
+        out->saved++;
+    } else {
+        out->failed++;
+    }
+}
+
+// A trous wavelet planes plus the (optionally detail-enhanced) reconstruction
+static int run_atrous(Image* input, Image* output, const char* output_file, int levels, float gain,
+                      ConvConfig* config) {
+    printf("\nRunning a trous wavelet transform...\n");
+    printf("  Levels: %d\n", levels);
+    printf("  Detail gain: %.3f\n", gain);
+    print_config(config);
+    printf("\n");
+
+    ScaleSpaceOutput out = {output_file, levels, 0, 0};
+    AtrousStats stats;
+    int ok = atrous_transform(input, output, levels, gain, config, save_atrous_plane, &out, &stats);
+    if (!ok || out.failed) {
+        fprintf(stderr, "Failed to run a trous transform\n");
+        return 0;
+    }
+
+    printf("\nPlanes written: %d\n", out.saved);
+    printf("Taps per pixel: %ld sparse vs %ld dense (%.2fx less work)\n",
+           stats.sparse_taps, stats.dense_taps, (double)stats.dense_taps / stats.sparse_taps);
+    printf("Convolution time: %.6f seconds\n", stats.convolve_time);
+    return 1;
+}
+
+// Separable 3-D Gaussian/box over a stack of slices
+static int run_volume(const char* list_file, const char* output_file, const char* filter_type,
+                      int kernel_size, const char* pixel_type, ConvConfig* config) {
+    printf("Loading volume slices...\n");
+    Volume* input = load_volume(list_file);
+    if (!input) {
+        fprintf(stderr, "Failed to load volume\n");
+        return 0;
+    }
+
+    if (pixel_type[0] && parse_pixel_type(pixel_type) != (int)input->type) {
+        PixelType type = (PixelType)parse_pixel_type(pixel_type);
+        for (int z = 0; z < input->depth; z++) {
+            Image* converted = convert_image(input->slice[z], type);
+            if (!converted) {
+                fprintf(stderr, "Failed to convert volume\n");
+                free_volume(input);
+                return 0;
+            }
+            free_image(input->slice[z]);
+            input->slice[z] = converted;
+        }
+        input->type = type;
+        printf("Converted volume to %s samples\n", pixel_type_name(type));
+    }
+
+    float* taps = strcmp(filter_type, "gaussian") == 0 ? create_gaussian_taps(kernel_size, kernel_size / 6.0f)
+                                                       : create_box_taps(kernel_size);
+    Volume* output = create_volume(input->width, input->height, input->depth, input->channels, input->type);
+    if (!taps || !output) {
+        fprintf(stderr, "Failed to create volume output\n");
+        free(taps);
+        free_volume(input);
+        free_volume(output);
+        return 0;
+    }
+
+    printf("\nRunning 3-D separable convolution...\n");
+    printf("  Volume: %dx%dx%d, %d channels, %s\n", input->width, input->height, input->depth,
+           input->channels, pixel_type_name(input->type));
+    printf("  Kernel: %dx%dx%d %s\n", kernel_size, kernel_size, kernel_size, filter_type);
+    print_config(config);
+    printf("\n");
+
+    double start_time = get_time();
+    if (!convolve_volume_separable(input, output, taps, kernel_size, config)) {
+        fprintf(stderr, "Failed to convolve volume\n");
+        free(taps);
+        free_volume(input);
+        free_volume(output);
+        return 0;
+    }
+    printf("Parallel time: %.6f seconds\n", get_time() - start_time);
+
+    printf("\nSaving output slices...\n");
+    int ok = save_volume(output_file, output);
+
+    free(taps);
+    free_volume(input);
+    free_volume(output);
+    return ok;
+}
+
+// Multi-stage row pipeline under one execution context
+static int run_pipeline_mode(Image* input, Image* output, const char* spec, ExecContext* ctx) {
+    Pipeline* p = parse_pipeline(spec);
+    if (!p) return 0;
+
+    printf("\nRunning pipeline...\n");
+    printf("  Stages:");
+    for (int s = 0; s < p->count; s++) {
+        printf(" %s", stage_name(&p->stage[s]));
+        if (p->stage[s].type == STAGE_THRESHOLD) printf(":%g", p->stage[s].param);
+        else if (p->stage[s].taps) printf(":%d", 2 * p->stage[s].radius + 1);
+    }
+    printf("\n");
+    printf("  Threads: %d\n", ctx->num_threads);
+    static const char* models[] = {"persistent (one region, band flags)", "regions (one per stage)",
+                                   "tasks (stage x band graph)", "stream (line buffers, independent bands)"};
+    printf("  Execution: %s\n\n", models[ctx->model]);
+
+    PipelineStats stats;
+    int ok = run_pipeline(ctx, p, input, output, &stats);
+    free_pipeline(p);
+    if (!ok) return 0;
+
+    printf("Parallel regions: %d, bands: %d", stats.regions, stats.bands);
+    if (stats.tasks) printf(", tasks: %d", stats.tasks);
+    printf("\n");
+    printf("Intermediate storage: %.1f KB%s\n", stats.buffer_bytes / 1024.0,
+           ctx->model == EXEC_STREAM ? " of line buffers per thread" : " of stage images");
+    printf("Parallel time: %.6f seconds\n", stats.elapsed);
+    return 1;
+}
+
+// Streaming spatio-temporal filter over a frame list; output frame t filters frames t-N+1..t
+static int run_temporal(const char* list_file, const char* output_file, const char* filter_type,
+                        int kernel_size, int window, const char* pixel_type, ConvConfig* config) {
+    int count = 0;
+    char** paths = read_path_list(list_file, &count);
+    if (!paths) return 0;
+
+    // Newest frame first; gaussian weights fall off with age (sigma = N/3), box weights are equal
+    float* weights = (float*)malloc(window * sizeof(float));
+    float* taps = strcmp(filter_type, "gaussian") == 0 ? create_gaussian_taps(kernel_size, kernel_size / 6.0f)
+                                                       : create_box_taps(kernel_size);
+    if (!weights || !taps) {
+        free(weights);
+        free(taps);
+        free_path_list(paths, count);
+        return 0;
+    }
+    for (int i = 0; i < window; i++) {
+        float sigma = window / 3.0f;
+        weights[i] = strcmp(filter_type, "gaussian") == 0 ? expf(-(i * i) / (2.0f * sigma * sigma)) : 1.0f;
+    }
+
+    printf("\nRunning streaming temporal filter...\n");
+    printf("  Frames: %d, window: %d\n", count, window);
+    printf("  Spatial kernel: %dx%d %s\n", kernel_size, kernel_size, filter_type);
+    print_config(config);
+    printf("\n");
+
+    FrameRing* ring = NULL;
+    Image* output = NULL;
+    double filter_time = 0.0;
+    int ok = 1;
+
+    for (int t = 0; ok && t < count; t++) {
+        Image* frame = load_image(paths[t]);
+        if (frame && pixel_type[0] && parse_pixel_type(pixel_type) != (int)frame->type) {
+            Image* converted = convert_image(frame, (PixelType)parse_pixel_type(pixel_type));
+            free_image(frame);
+            frame = converted;
+        }
+        if (!frame) {
+            ok = 0;
+            break;
+        }
+
+        if (!ring) {
+            ring = create_frame_ring(window, frame->width, frame->height, frame->channels, frame->type, weights);
+            output = create_image_typed(frame->width, frame->height, frame->channels, frame->type);
+            if (!ring || !output) {
+                fprintf(stderr, "Failed to allocate frame ring\n");
+                free_image(frame);
+                ok = 0;
+                break;
+            }
+        } else if (frame->width != output->width || frame->height != output->height ||
+                   frame->channels != output->channels || frame->type != output->type) {
+            fprintf(stderr, "Frame %s does not match the first frame\n", paths[t]);
+            free_image(frame);
+            ok = 0;
+            break;
+        }
+
+        frame_ring_push(ring, frame);
+        free_image(frame);
+
+        double start_time = get_time();
+        filter_spatiotemporal(ring, output, taps, kernel_size, config);
+        filter_time += get_time() - start_time;
+
+        char suffix[32];
+        char path[1024];
+        snprintf(suffix, sizeof(suffix), "_f%03d", t);
+        suffixed_path(path, sizeof(path), output_file, suffix);
+        ok = save_image(path, output);
+    }
+
+    if (ok) {
+        printf("\nFilter time: %.6f seconds (%.6f per frame)\n", filter_time, filter_time / count);
+    }
+
+    free_frame_ring(ring);
+    free_image(output);
+    free(weights);
+    free(taps);
+    free_path_list(paths, count);
+    return ok;
+}
+
+// Learned per-thread weights of -s adaptive, e.g. "1.04 0.96 1.00 1.00"
+static void print_thread_weights(const char* label, const ThreadWeights* w) {
+    printf("%s:", label);
+    for (int i = 0; i < w->threads; i++) {
+        printf(" %.2f", w->weight[i]);
+    }
+    printf("\n");
+}
+
+// Direct convolution of every image in a list, several images at a time on nested teams
+static int run_batch(const char* list_file, const char* output_file, const char* filter_type, int kernel_size,
+                     float angle, const char* pixel_type, int in_flight, ConvConfig* config) {
+    int count = 0;
+    char** paths = read_path_list(list_file, &count);
+    if (!paths) return 0;
+
+    float** kernel;
+    if (strcmp(filter_type, "gaussian") == 0) {
+        kernel = create_gaussian_kernel(kernel_size, kernel_size / 6.0f);
+    } else if (strcmp(filter_type, "box") == 0) {
+        kernel = create_box_kernel(kernel_size);
+    } else if (strcmp(filter_type, "ring") == 0) {
+        kernel = create_ring_kernel(kernel_size);
+    } else if (strcmp(filter_type, "line") == 0) {
+        kernel = create_line_kernel(kernel_size, angle);
+    } else {
+        fprintf(stderr, "Unknown filter type: %s\n", filter_type);
+        free_path_list(paths, count);
+        return 0;
+    }
+
+    // Output i is the -o path with _NNNN before the extension
+    char** out_paths = (char**)calloc(count, sizeof(char*));
+    int ok = kernel && out_paths;
+    for (int i = 0; ok && i < count; i++) {
+        char suffix[32];
+        char path[1024];
+        snprintf(suffix, sizeof(suffix), "_%04d", i);
+        suffixed_path(path, sizeof(path), output_file, suffix);
+        out_paths[i] = strdup(path);
+        ok = out_paths[i] != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to set up batch\n");
+        free_kernel(kernel, kernel_size);
+        free_path_list(out_paths, count);
+        free_path_list(paths, count);
+        return 0;
+    }
+
+    printf("\nRunning batch convolution...\n");
+    printf("  Images: %d\n", count);
+    printf("  Kernel: %dx%d %s\n", kernel_size, kernel_size, filter_type);
+    print_config(config);
+
+    BatchStats stats = {0};
+    int done = convolve_batch(paths, out_paths, count, pixel_type[0] ? parse_pixel_type(pixel_type) : -1, kernel,
+                              kernel_size, in_flight, config, &stats);
+    if (done > 0) {
+        printf("\nImages: %d done, %d failed\n", stats.images, stats.failed);
+        if (strcmp(config->schedule_type, "adaptive") == 0 && stats.weights) {
+            print_thread_weights("Learned thread weights (outer thread 0)", &stats.weights[0]);
+        }
+        printf("Throughput: %.1f images/s, %.1f Mpixel/s\n", stats.images / stats.elapsed,
+               stats.pixels / stats.elapsed / 1e6);
+        printf("Batch time: %.6f seconds\n", stats.elapsed);
+    }
+
+    free(stats.weights);
+    free_kernel(kernel, kernel_size);
+    free_path_list(out_paths, count);
+    free_path_list(paths, count);
+    return done == count;
+}
+
+// Richardson-Lucy deconvolution with a PSF from an image or the -f/-k kernel
+static int run_deconv(Image* input, Image* output, const char* psf_file, const char* filter_type,
+                      int kernel_size, int iterations, ConvConfig* config) {
+    int psf_size = kernel_size;
+    float** kernel;
+    if (psf_file) {
+        kernel = load_psf(psf_file, &psf_size);
+    } else if (strcmp(filter_type, "gaussian") == 0) {
+        kernel = create_gaussian_kernel(kernel_size, kernel_size / 6.0f);
+    } else {
+        kernel = create_box_kernel(kernel_size);
+    }
+    if (!kernel) {
+        fprintf(stderr, "Failed to create PSF\n");
+        return 0;
+    }
+
+    PreparedPSF* psf = prepare_psf(kernel, psf_size);
+    free_kernel(kernel, psf_size);
+    if (!psf) {
+        fprintf(stderr, "Failed to prepare PSF\n");
+        return 0;
+    }
+
+    printf("\nRunning Richardson-Lucy deconvolution...\n");
+    printf("  PSF: %dx%d %s (%s)\n", psf_size, psf_size, psf_file ? psf_file : filter_type,
+           psf->separable ? "separable" : "non-separable");
+    printf("  Iterations: %d\n", iterations);
+    print_config(config);
+    printf("\n");
+
+    DeconvStats stats;
+    int ok = deconvolve_richardson_lucy(input, output, psf, iterations, config, &stats);
+    free_prepared_psf(psf);
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate deconvolution buffers\n");
+        return 0;
+    }
+
+    printf("Execution time: %.6f seconds\n", stats.total_time);
+    printf("Time per iteration: %.6f seconds\n", stats.time_per_iteration);
+    return 1;
+}
+
 int main(int argc, char** argv) {
     // Default parameters
     char* input_file = NULL;
@@ -27,14 +550,46 @@ int main(int argc, char** argv) {
     int kernel_size = 3;
     int sequential = 0;
     char filter_type[16] = "gaussian";
+    char mode[16] = "convolve";
+    int levels = 5;
+    float gain = 1.0f;
+    int out_width = 0;
+    int out_height = 0;
+    char resize_filter[16] = "lanczos3";
+    float blur_sigma = 0.0f;
+    char pixel_type[8] = "";
+    char* map_file = "vignette";
+    float max_sigma = 8.0f;
+    int quant_levels = 16;
+    float sigma0 = 1.6f;
+    float ratio = 1.41421356f;
+    char* psf_file = NULL;
+    int iterations = 0;
+    int time_block = 0;
+    int dilation = 1;
+    int window = 5;
+    char* stages = "gaussian:5,sobel,threshold:64";
+    char exec_model[16] = "persistent";
+    int band_rows = 0;
+    char numa_policy[16] = "off";
+    float angle = 0.0f;
+    int autotune = 0;
+    const char* wisdom_file = NULL;
+    unsigned given = 0;
+    int tile_auto = 0;
+    int in_flight = 0;
+    int threads_auto = 0;
     
     ConvConfig config = {
         .num_threads = 4,
         .schedule_type = "static",
         .chunk_size = 1,
         .tile_size = 0,
-        .loop_order = 0
+        .loop_order = 0,
+        .half_intermediates = 0,
+        .affinity = "none"
     };
+    char engine[16] = "direct";
 
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -45,17 +600,89 @@ int main(int argc, char** argv) {
         } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
             kernel_size = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
-            config.num_threads = atoi(argv[++i]);
+            const char* threads = argv[++i];
+            threads_auto = strcmp(threads, "auto") == 0;
+            config.num_threads = threads_auto ? available_cpus(NULL) : atoi(threads);
+            // -t auto is a choice too: loaded wisdom must not replace it
+            given |= TUNE_THREADS;
         } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
             strncpy(config.schedule_type, argv[++i], sizeof(config.schedule_type) - 1);
+            given |= TUNE_SCHEDULE;
         } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
             config.chunk_size = atoi(argv[++i]);
+            given |= TUNE_CHUNK;
         } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
             config.loop_order = atoi(argv[++i]);
+            given |= TUNE_ORDER;
         } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
-            config.tile_size = atoi(argv[++i]);
+            const char* tile = argv[++i];
+            if (strcmp(tile, "auto") == 0) {
+                tile_auto = 1;
+            } else if (sscanf(tile, "%dx%d", &config.tile_width, &config.tile_size) != 2) {
+                config.tile_size = atoi(tile);
+                config.tile_width = 0;
+            }
+            given |= TUNE_TILE;
         } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
             strncpy(filter_type, argv[++i], sizeof(filter_type) - 1);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            strncpy(engine, argv[++i], sizeof(engine) - 1);
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            config.half_intermediates = strcmp(argv[++i], "fp16") == 0;
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            strncpy(mode, argv[++i], sizeof(mode) - 1);
+        } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            levels = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            gain = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+            out_width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            out_height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            strncpy(resize_filter, argv[++i], sizeof(resize_filter) - 1);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            blur_sigma = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            map_file = argv[++i];
+        } else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            max_sigma = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            quant_levels = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sigma0") == 0 && i + 1 < argc) {
+            sigma0 = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ratio") == 0 && i + 1 < argc) {
+            ratio = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            dilation = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--angle") == 0 && i + 1 < argc) {
+            angle = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--stages") == 0 && i + 1 < argc) {
+            stages = argv[++i];
+        } else if (strcmp(argv[i], "--exec") == 0 && i + 1 < argc) {
+            strncpy(exec_model, argv[++i], sizeof(exec_model) - 1);
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            band_rows = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) {
+            strncpy(config.affinity, argv[++i], sizeof(config.affinity) - 1);
+        } else if (strcmp(argv[i], "--numa") == 0 && i + 1 < argc) {
+            strncpy(numa_policy, argv[++i], sizeof(numa_policy) - 1);
+        } else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc) {
+            window = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--inflight") == 0 && i + 1 < argc) {
+            in_flight = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+            psf_file = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--time-block") == 0 && i + 1 < argc) {
+            time_block = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            strncpy(pixel_type, argv[++i], sizeof(pixel_type) - 1);
+        } else if (strcmp(argv[i], "--autotune") == 0) {
+            autotune = 1;
+        } else if (strcmp(argv[i], "--wisdom") == 0 && i + 1 < argc) {
+            wisdom_file = argv[++i];
         } else if (strcmp(argv[i], "-S") == 0) {
             sequential = 1;
         } else if (strcmp(argv[i], "-h") == 0) {
@@ -71,14 +698,148 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    static const char* modes[] = {"convolve", "laplacian", "resize", "varying", "scalespace", "deconv", "atrous", "volume", "temporal", "pipeline", "batch"};
+    int known_mode = 0;
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        known_mode |= strcmp(mode, modes[m]) == 0;
+    }
+    if (!known_mode) {
+        fprintf(stderr, "Error: Unknown mode: %s\n", mode);
+        return 1;
+    }
+
+    if (strcmp(engine, "direct") != 0 && strcmp(engine, "separable") != 0 && strcmp(engine, "sparse") != 0 &&
+        strcmp(engine, "recursive") != 0) {
+        fprintf(stderr, "Error: Unknown engine: %s\n", engine);
+        return 1;
+    }
+
+    int separable_filter = strcmp(filter_type, "gaussian") == 0 || strcmp(filter_type, "box") == 0;
+    if (strcmp(engine, "separable") == 0 && !separable_filter) {
+        fprintf(stderr, "Error: The separable engine needs a gaussian or box filter\n");
+        return 1;
+    }
+    if (dilation < 1 || (dilation > 1 && strcmp(engine, "sparse") != 0)) {
+        fprintf(stderr, "Error: Dilation must be 1, or greater with the sparse engine\n");
+        return 1;
+    }
+
+    if (pixel_type[0] && parse_pixel_type(pixel_type) < 0) {
+        fprintf(stderr, "Error: Unknown pixel type: %s\n", pixel_type);
+        return 1;
+    }
+
+    if (strcmp(mode, "resize") == 0) {
+        if (out_width <= 0 && out_height <= 0) {
+            fprintf(stderr, "Error: Resize mode requires -W and/or -H\n");
+            return 1;
+        }
+        if (parse_resize_filter(resize_filter) < 0) {
+            fprintf(stderr, "Error: Unknown resize filter: %s\n", resize_filter);
+            return 1;
+        }
+    }
+
     // Validate kernel size
-    if (kernel_size != 3 && kernel_size != 31) {
+    if ((strcmp(mode, "convolve") == 0 || strcmp(mode, "batch") == 0) && kernel_size != 3 && kernel_size != 31) {
         fprintf(stderr, "Error: Kernel size must be 3 or 31\n");
         return 1;
     }
+    if (strcmp(mode, "deconv") == 0 && (kernel_size < 1 || kernel_size % 2 == 0)) {
+        fprintf(stderr, "Error: PSF size must be odd\n");
+        return 1;
+    }
+    int stack_mode = strcmp(mode, "volume") == 0 || strcmp(mode, "temporal") == 0;
+    if (stack_mode && (kernel_size < 1 || kernel_size % 2 == 0 || !separable_filter)) {
+        fprintf(stderr, "Error: %s mode needs an odd-sized gaussian or box filter\n", mode);
+        return 1;
+    }
+    if (strcmp(exec_model, "persistent") != 0 && strcmp(exec_model, "regions") != 0 &&
+        strcmp(exec_model, "tasks") != 0 && strcmp(exec_model, "stream") != 0) {
+        fprintf(stderr, "Error: Unknown execution model: %s\n", exec_model);
+        return 1;
+    }
+    if (strcmp(numa_policy, "off") != 0 && strcmp(numa_policy, "first-touch") != 0 &&
+        strcmp(numa_policy, "replicate") != 0) {
+        fprintf(stderr, "Error: Unknown NUMA policy: %s\n", numa_policy);
+        return 1;
+    }
+    if (strcmp(numa_policy, "replicate") == 0 && (strcmp(engine, "direct") != 0 || config.tile_size > 0 || tile_auto)) {
+        fprintf(stderr, "Error: Input replication needs the untiled direct engine\n");
+        return 1;
+    }
+    if (autotune && (strcmp(mode, "convolve") != 0 || strcmp(engine, "direct") != 0 || sequential ||
+                     strcmp(numa_policy, "replicate") == 0)) {
+        fprintf(stderr, "Error: --autotune tunes the parallel direct engine in convolve mode\n");
+        return 1;
+    }
+    if (!wisdom_file) wisdom_file = default_wisdom_path();
+    if (strcmp(wisdom_file, "none") == 0) wisdom_file = NULL;
+
+    if (strcmp(mode, "convolve") == 0 && iterations > 1 &&
+        (strcmp(engine, "direct") != 0 || sequential || strcmp(numa_policy, "replicate") == 0 || autotune)) {
+        fprintf(stderr, "Error: -n in convolve mode needs the parallel direct engine\n");
+        return 1;
+    }
+
+    if (strcmp(mode, "batch") == 0 && (strcmp(engine, "direct") != 0 || sequential || iterations > 1 ||
+                                       tile_auto || in_flight < 0)) {
+        fprintf(stderr, "Error: batch mode runs the parallel direct engine (fixed -T tiles only)\n");
+        return 1;
+    }
+
+    // Each level blurs the previous one by sqrt(sigma^2 - prev^2), so sigma must grow
+    if (strcmp(mode, "scalespace") == 0 && (!(sigma0 > 0.0f) || !(ratio > 1.0f))) {
+        fprintf(stderr, "Error: Scale space needs --sigma0 > 0 and --ratio > 1\n");
+        return 1;
+    }
+    if (strcmp(mode, "scalespace") == 0 && levels < 1) {
+        fprintf(stderr, "Error: Scale space needs at least 1 level\n");
+        return 1;
+    }
+
+    if (strcmp(mode, "temporal") == 0 && window < 1) {
+        fprintf(stderr, "Error: Temporal window must be at least 1 frame\n");
+        return 1;
+    }
 
     printf("=== 2D Convolution with OpenMP ===\n\n");
 
+    // Usable CPUs, counted before -A narrows the main thread's mask to one CPU
+    int quota = 0;
+    int cpus = available_cpus(&quota);
+    if (!threads_auto && !sequential && config.num_threads > cpus) {
+        printf("Note: %d threads on %d usable CPU%s%s; -t auto never oversubscribes\n\n", config.num_threads, cpus,
+               cpus > 1 ? "s" : "", quota > 0 && quota == cpus ? " (cgroup quota)" : "");
+    }
+
+    // Pin the team before any work so every engine runs on the same cores
+    if (strcmp(config.affinity, "none") != 0) {
+        if (!apply_affinity(&config)) return 1;
+        printf("\n");
+    }
+
+    if (strcmp(mode, "volume") == 0) {
+        // The input is a list of slices, loaded as one volume
+        if (!run_volume(input_file, output_file, filter_type, kernel_size, pixel_type, &config)) return 1;
+        printf("\n%s completed successfully!\n", mode);
+        return 0;
+    }
+    if (strcmp(mode, "temporal") == 0) {
+        // Frames are decoded and filtered one at a time
+        if (!run_temporal(input_file, output_file, filter_type, kernel_size, window, pixel_type, &config)) return 1;
+        printf("\n%s completed successfully!\n", mode);
+        return 0;
+    }
+    if (strcmp(mode, "batch") == 0) {
+        // Images are loaded and saved by the threads that convolve them
+        if (!run_batch(input_file, output_file, filter_type, kernel_size, angle, pixel_type, in_flight, &config)) {
+            return 1;
+        }
+        printf("\n%s completed successfully!\n", mode);
+        return 0;
+    }
+
     // Load input image
     printf("Loading input image...\n");
     Image* input = load_image(input_file);
@@ -87,22 +848,89 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (pixel_type[0] && parse_pixel_type(pixel_type) != (int)input->type) {
+        Image* converted = convert_image(input, (PixelType)parse_pixel_type(pixel_type));
+        free_image(input);
+        if (!converted) {
+            fprintf(stderr, "Failed to convert input image\n");
+            return 1;
+        }
+        input = converted;
+        printf("Converted input to %s samples\n", pixel_type_name(input->type));
+    }
+
     // Create output image
-    Image* output = create_image(input->width, input->height, input->channels);
+    int output_w = input->width;
+    int output_h = input->height;
+    if (strcmp(mode, "resize") == 0) {
+        // Keep the aspect ratio when only one dimension is given
+        if (out_width <= 0) out_width = (int)((long)input->width * out_height / input->height);
+        if (out_height <= 0) out_height = (int)((long)input->height * out_width / input->width);
+        output_w = out_width > 0 ? out_width : 1;
+        output_h = out_height > 0 ? out_height : 1;
+    }
+    Image* output = create_image_typed(output_w, output_h, input->channels, input->type);
     if (!output) {
         fprintf(stderr, "Failed to create output image\n");
         free_image(input);
         return 1;
     }
 
+    if (strcmp(mode, "convolve") != 0) {
+        int ok;
+        if (strcmp(mode, "scalespace") == 0) {
+            // Levels are written as they are produced
+            ok = run_scalespace(input, output_file, levels, sigma0, ratio, &config);
+            free_image(input);
+            free_image(output);
+            if (!ok) return 1;
+            printf("\n%s completed successfully!\n", mode);
+            return 0;
+        } else if (strcmp(mode, "laplacian") == 0) {
+            ok = run_laplacian(input, output, levels, gain, &config);
+        } else if (strcmp(mode, "varying") == 0) {
+            ok = run_varying(input, output, map_file, max_sigma, quant_levels, &config);
+        } else if (strcmp(mode, "pipeline") == 0) {
+            ExecContext ctx = {config.num_threads, band_rows,
+                               strcmp(exec_model, "regions") == 0 ? EXEC_REGIONS :
+                               strcmp(exec_model, "tasks") == 0 ? EXEC_TASKS :
+                               strcmp(exec_model, "stream") == 0 ? EXEC_STREAM : EXEC_PERSISTENT};
+            ok = run_pipeline_mode(input, output, stages, &ctx);
+        } else if (strcmp(mode, "atrous") == 0) {
+            ok = run_atrous(input, output, output_file, levels, gain, &config);
+        } else if (strcmp(mode, "deconv") == 0) {
+            ok = run_deconv(input, output, psf_file, filter_type, kernel_size, iterations > 0 ? iterations : 20,
+                            &config);
+        } else {
+            ok = run_resize(input, output, (ResizeFilter)parse_resize_filter(resize_filter),
+                            resize_filter, blur_sigma, &config);
+        }
+        if (ok) {
+            printf("\nSaving output image...\n");
+            ok = save_image(output_file, output);
+        }
+        free_image(input);
+        free_image(output);
+        if (!ok) return 1;
+        printf("\n%s completed successfully!\n", mode);
+        return 0;
+    }
+
     // Create kernel
     printf("Creating %dx%d %s kernel...\n", kernel_size, kernel_size, filter_type);
     float** kernel;
+    float* taps = NULL;
     if (strcmp(filter_type, "gaussian") == 0) {
         float sigma = kernel_size / 6.0f;
         kernel = create_gaussian_kernel(kernel_size, sigma);
+        taps = create_gaussian_taps(kernel_size, sigma);
     } else if (strcmp(filter_type, "box") == 0) {
         kernel = create_box_kernel(kernel_size);
+        taps = create_box_taps(kernel_size);
+    } else if (strcmp(filter_type, "ring") == 0) {
+        kernel = create_ring_kernel(kernel_size);
+    } else if (strcmp(filter_type, "line") == 0) {
+        kernel = create_line_kernel(kernel_size, angle);
     } else {
         fprintf(stderr, "Unknown filter type: %s\n", filter_type);
         free_image(input);
@@ -110,8 +938,10 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    if (!kernel) {
+    if (!kernel || (separable_filter && !taps)) {
         fprintf(stderr, "Failed to create kernel\n");
+        free_kernel(kernel, kernel_size);
+        free(taps);
         free_image(input);
         free_image(output);
         return 1;
@@ -122,6 +952,81 @@ int main(int argc, char** argv) {
         print_kernel(kernel, kernel_size);
     }
 
+    // Rectangular tiles sized to this host's L1/L2
+    if (tile_auto) {
+        choose_tile_shape(input->width, input->height, input->channels, input->type, kernel_size,
+                          config.num_threads, &config.tile_width, &config.tile_size);
+        printf("Auto tile: %dx%d (L1 %ld KB, L2 %ld KB)\n", config.tile_width, config.tile_size,
+               cache_size(1) / 1024, cache_size(2) / 1024);
+    }
+
+    // Team size from the work per image, the fork/join cost and the usable CPUs
+    if (threads_auto && !sequential && strcmp(engine, "direct") == 0 && strcmp(numa_policy, "replicate") != 0 &&
+        iterations <= 1) {
+        AutoThreadStats auto_stats;
+        config.num_threads = choose_thread_count(input, kernel, kernel_size, &config, cpus, &auto_stats);
+        printf("Auto threads: %d of %d usable CPUs (%.1fM multiply-adds, %.6f s on one thread, "
+               "fork/join %.1f us, predicted %.6f s)\n", config.num_threads, auto_stats.cpus,
+               auto_stats.work / 1e6, auto_stats.work_time, auto_stats.fork_join * 1e6, auto_stats.predicted);
+    }
+
+    // Tune the direct engine, or reuse an earlier tuning for this problem and CPU. Options
+    // given on the command line take precedence over loaded wisdom.
+    if (!sequential && strcmp(engine, "direct") == 0 && strcmp(numa_policy, "replicate") != 0 &&
+        (autotune || wisdom_file)) {
+        TuneKey key;
+        ConvConfig tuned = config;
+        make_tune_key(&key, input, kernel_size);
+        if (autotune) {
+            printf("\n");
+            double best = autotune_direct(input, kernel, kernel_size, &config, &tuned);
+            if (best > 0.0) {
+                config = tuned;
+                if (wisdom_file && save_wisdom(wisdom_file, &key, &tuned, best)) {
+                    printf("Saved wisdom to %s\n", wisdom_file);
+                }
+            }
+        } else if (load_wisdom(wisdom_file, &key, &tuned)) {
+            apply_wisdom(&tuned, &config, given);
+            printf("Loaded wisdom from %s\n", wisdom_file);
+        }
+    }
+
+    // Place pages with the engines' row partition; optionally replicate the input per node
+    ImageReplicas* replicas = NULL;
+    if (!sequential && strcmp(numa_policy, "off") != 0) {
+        Image* placed_input = copy_image_first_touch(input, &config);
+        Image* placed_output = create_image_first_touch(output->width, output->height, output->channels,
+                                                        output->type, &config);
+        if (strcmp(numa_policy, "replicate") == 0 && placed_input) {
+            replicas = replicate_image(placed_input, &config);
+        }
+        if (!placed_input || !placed_output || (strcmp(numa_policy, "replicate") == 0 && !replicas)) {
+            fprintf(stderr, "Failed to place images\n");
+            free_image(placed_input);
+            free_image(placed_output);
+            free_image_replicas(replicas);
+            free_kernel(kernel, kernel_size);
+            free(taps);
+            free_image(input);
+            free_image(output);
+            return 1;
+        }
+        free_image(input);
+        free_image(output);
+        input = placed_input;
+        output = placed_output;
+
+        printf("\nNUMA policy: %s (%d node%s)\n", numa_policy, numa_node_count(), numa_node_count() > 1 ? "s" : "");
+        report_page_placement("input", input);
+        report_page_placement("output", output);
+        for (int n = 0; replicas && n < replicas->nodes; n++) {
+            char label[32];
+            snprintf(label, sizeof(label), "input replica %d", n);
+            report_page_placement(label, replicas->copy[n]);
+        }
+    }
+
     // Perform convolution
     double start_time, end_time;
 
@@ -133,19 +1038,67 @@ int main(int argc, char** argv) {
         printf("Sequential time: %.6f seconds\n", end_time - start_time);
     } else {
         printf("\nRunning OpenMP parallel convolution...\n");
+        printf("Engine: %s\n", engine);
         print_config(&config);
         printf("\n");
 
+        SparseKernel* sparse = NULL;
+        if (strcmp(engine, "sparse") == 0) {
+            sparse = create_sparse_kernel(kernel, kernel_size, dilation);
+            if (!sparse) {
+                fprintf(stderr, "Failed to create sparse kernel\n");
+                free_kernel(kernel, kernel_size);
+                free(taps);
+                free_image(input);
+                free_image(output);
+                return 1;
+            }
+            printf("Sparse taps: %d of %d (dilation %d, extent %dx%d)\n\n", sparse->count,
+                   kernel_size * kernel_size, dilation, 2 * sparse->radius + 1, 2 * sparse->radius + 1);
+        }
+
+        // Per-thread weights learned during the run
+        ThreadWeights weights = {0};
+        if (strcmp(config.schedule_type, "adaptive") == 0) config.weights = &weights;
+
+        int ok = 1;
         start_time = get_time();
-        if (config.tile_size > 0) {
-            convolve_openmp_tiled(input, output, kernel, kernel_size, &config);
+        if (iterations > 1) {
+            IterateStats iter;
+            if (!convolve_iterated(input, output, kernel, kernel_size, iterations, time_block, &config, &iter)) {
+                free_kernel(kernel, kernel_size);
+                free(taps);
+                free_image(input);
+                free_image(output);
+                return 1;
+            }
+            printf("Iterations: %d in %d pass%s over the image (time block %d, %d tiles of %dx%d)\n",
+                   iter.iterations, iter.sweeps, iter.sweeps > 1 ? "es" : "", iter.time_block, iter.tiles,
+                   iter.tile_w, iter.tile_h);
+        } else if (sparse) {
+            ok = convolve_sparse(input, output, sparse, &config);
+        } else if (strcmp(engine, "separable") == 0) {
+            convolve_separable(input, output, taps, kernel_size, &config);
         } else {
-            convolve_openmp(input, output, kernel, kernel_size, &config);
+            ok = convolve_direct(input, output, kernel, kernel_size, strcmp(engine, "recursive") == 0, replicas,
+                                 &config);
         }
         end_time = get_time();
+        free_sparse_kernel(sparse);
+        free_image_replicas(replicas);
+        if (!ok) {
+            fprintf(stderr, "Failed to convolve image\n");
+            free_kernel(kernel, kernel_size);
+            free(taps);
+            free_image(input);
+            free_image(output);
+            return 1;
+        }
 
         double elapsed = end_time - start_time;
         printf("Parallel time: %.6f seconds\n", elapsed);
+        if (weights.runs > 0) print_thread_weights("Learned thread weights", &weights);
+        config.weights = NULL;
         
         // Calculate theoretical speedup info
         printf("Threads used: %d\n", config.num_threads);
@@ -156,6 +1109,7 @@ int main(int argc, char** argv) {
     if (!save_image(output_file, output)) {
         fprintf(stderr, "Failed to save output image\n");
         free_kernel(kernel, kernel_size);
+        free(taps);
         free_image(input);
         free_image(output);
         return 1;
@@ -163,6 +1117,7 @@ int main(int argc, char** argv) {
 
     // Cleanup
     free_kernel(kernel, kernel_size);
+    free(taps);
     free_image(input);
     free_image(output);
 
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Hybrid MPI + OpenMP driver (make mpi): the image is cut into horizontal bands, one
+// per rank. Rank 0 loads the image and scatters the bands; neighbours then swap the
+// kernel_size / 2 rows each needs from the other as halo, every rank convolves its band
+// plus halo with the usual OpenMP engines on -t threads, and rank 0 gathers the band
+// rows (without halos) and saves the result. Top and bottom bands have no halo on the
+// image edge, which leaves the engines' zero padding exactly where it is for one process.
+
+static void print_usage(const char* prog_name) {
+    printf("Usage: mpirun -np <ranks> %s [options]\n", prog_name);
+    printf("Options:\n");
+    printf("  -i <input>        Input image file (required)\n");
+    printf("  -o <output>       Output image file (required)\n");
+    printf("  -k <size>         Kernel size (3 or 31, default: 3)\n");
+    printf("  -t <threads>      OpenMP threads per rank, or auto to share the node's usable CPUs (default: 4)\n");
+    printf("  -s <schedule>     Schedule type: static, dynamic, guided, steal, adaptive (default: static)\n");
+    printf("  -c <chunk>        Chunk size (default: 1)\n");
+    printf("  -T <tile>         Tile size: 0=no tiling, N for NxN or WxH (default: 0)\n");
+    printf("  -f <filter>       Filter type: gaussian, box, ring, line (default: gaussian)\n");
+    printf("  -e <engine>       Convolution engine: direct, separable, recursive (default: direct)\n");
+    printf("  -p <type>         Convert input samples to u8, u16 or f32 before processing\n");
+    printf("  -h                Show this help message\n");
+}
+
+// Image shape sent from rank 0 to every rank
+typedef struct {
+    int width;
+    int height;
+    int channels;
+    int type;
+} ImageShape;
+
+// First row of band `rank` of `ranks` over `height` rows
+static int band_start(int height, int ranks, int rank) {
+    return (int)((long)height * rank / ranks);
+}
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    char* input_file = NULL;
+    char* output_file = NULL;
+    int kernel_size = 3;
+    char filter_type[16] = "gaussian";
+    char engine[16] = "direct";
+    char pixel_type[8] = "";
+    int threads_auto = 0;
+    ConvConfig config = {
+        .num_threads = 4,
+        .schedule_type = "static",
+        .chunk_size = 1,
+        .tile_size = 0,
+        .loop_order = 0,
+        .half_intermediates = 0,
+        .affinity = "none"
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            input_file = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            kernel_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            const char* threads = argv[++i];
+            threads_auto = strcmp(threads, "auto") == 0;
+            if (!threads_auto) config.num_threads = atoi(threads);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            strncpy(config.schedule_type, argv[++i], sizeof(config.schedule_type) - 1);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            config.chunk_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            const char* tile = argv[++i];
+            if (sscanf(tile, "%dx%d", &config.tile_width, &config.tile_size) != 2) {
+                config.tile_size = atoi(tile);
+                config.tile_width = 0;
+            }
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            strncpy(filter_type, argv[++i], sizeof(filter_type) - 1);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            strncpy(engine, argv[++i], sizeof(engine) - 1);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            strncpy(pixel_type, argv[++i], sizeof(pixel_type) - 1);
+        } else if (strcmp(argv[i], "-h") == 0) {
+            if (rank == 0) print_usage(argv[0]);
+            MPI_Finalize();
+            return 0;
+        }
+    }
+
+    // -t auto: the usable CPUs shared between the ranks on this node
+    if (threads_auto) {
+        MPI_Comm node;
+        int node_ranks;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+        MPI_Comm_size(node, &node_ranks);
+        MPI_Comm_free(&node);
+        config.num_threads = available_cpus(NULL) / node_ranks > 0 ? available_cpus(NULL) / node_ranks : 1;
+    }
+
+    // Every rank parses the same arguments, so they all reach the same verdict
+    const char* error = NULL;
+    int separable_filter = strcmp(filter_type, "gaussian") == 0 || strcmp(filter_type, "box") == 0;
+    if (!input_file || !output_file) {
+        error = "Input and output files are required";
+    } else if (kernel_size != 3 && kernel_size != 31) {
+        error = "Kernel size must be 3 or 31";
+    } else if (strcmp(engine, "direct") != 0 && strcmp(engine, "separable") != 0 &&
+               strcmp(engine, "recursive") != 0) {
+        error = "Engine must be direct, separable or recursive";
+    } else if (!separable_filter && strcmp(filter_type, "ring") != 0 && strcmp(filter_type, "line") != 0) {
+        error = "Filter type must be gaussian, box, ring or line";
+    } else if (strcmp(engine, "separable") == 0 && !separable_filter) {
+        error = "The separable engine needs a gaussian or box filter";
+    } else if (pixel_type[0] && parse_pixel_type(pixel_type) < 0) {
+        error = "Unknown pixel type";
+    } else if (config.num_threads < 1) {
+        error = "Thread count must be at least 1";
+    }
+    if (error) {
+        if (rank == 0) {
+            fprintf(stderr, "Error: %s\n", error);
+            print_usage(argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Rank 0 loads the image and shares its shape; width 0 means it failed
+    Image* full = NULL;
+    ImageShape shape = {0, 0, 0, 0};
+    if (rank == 0) {
+        printf("=== 2D Convolution with MPI + OpenMP ===\n\n");
+        printf("Loading input image...\n");
+        full = load_image(input_file);
+        if (full && pixel_type[0] && parse_pixel_type(pixel_type) != (int)full->type) {
+            Image* converted = convert_image(full, (PixelType)parse_pixel_type(pixel_type));
+            free_image(full);
+            full = converted;
+        }
+        if (full) {
+            shape.width = full->width;
+            shape.height = full->height;
+            shape.channels = full->channels;
+            shape.type = full->type;
+        } else {
+            fprintf(stderr, "Failed to load input image\n");
+        }
+    }
+    MPI_Bcast(&shape, sizeof(shape), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    int halo = kernel_size / 2;
+    if (shape.width == 0 || shape.height / ranks < halo) {
+        if (rank == 0 && shape.width > 0) {
+            fprintf(stderr, "Error: %d ranks leave bands thinner than the %d-row halo\n", ranks, halo);
+        }
+        free_image(full);
+        MPI_Finalize();
+        return 1;
+    }
+
+    // One row of pixels is the unit of every transfer, so counts stay small
+    long row_bytes = (long)shape.width * shape.channels * pixel_size((PixelType)shape.type);
+    MPI_Datatype row_type;
+    MPI_Type_contiguous((int)row_bytes, MPI_BYTE, &row_type);
+    MPI_Type_commit(&row_type);
+
+    int* counts = (int*)malloc(ranks * sizeof(int));
+    int* displs = (int*)malloc(ranks * sizeof(int));
+    for (int r = 0; r < ranks; r++) {
+        displs[r] = band_start(shape.height, ranks, r);
+        counts[r] = band_start(shape.height, ranks, r + 1) - displs[r];
+    }
+
+    // Local image: halo above (except on rank 0), the band, halo below (except on the last rank)
+    int band_rows = counts[rank];
+    int halo_top = rank > 0 ? halo : 0;
+    int halo_bottom = rank < ranks - 1 ? halo : 0;
+    int local_rows = halo_top + band_rows + halo_bottom;
+    Image* local_in = create_image_typed(shape.width, local_rows, shape.channels, (PixelType)shape.type);
+    Image* local_out = create_image_typed(shape.width, local_rows, shape.channels, (PixelType)shape.type);
+    if (!local_in || !local_out) {
+        fprintf(stderr, "Rank %d: failed to allocate band buffers\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    uint8_t* band = local_in->data + halo_top * row_bytes;
+
+    float** kernel = NULL;
+    float* taps = NULL;
+    if (strcmp(filter_type, "gaussian") == 0) {
+        kernel = create_gaussian_kernel(kernel_size, kernel_size / 6.0f);
+        taps = create_gaussian_taps(kernel_size, kernel_size / 6.0f);
+    } else if (strcmp(filter_type, "box") == 0) {
+        kernel = create_box_kernel(kernel_size);
+        taps = create_box_taps(kernel_size);
+    } else if (strcmp(filter_type, "ring") == 0) {
+        kernel = create_ring_kernel(kernel_size);
+    } else if (strcmp(filter_type, "line") == 0) {
+        kernel = create_line_kernel(kernel_size, 0.0f);
+    }
+
+    if (rank == 0) {
+        printf("\nRunning MPI band decomposition...\n");
+        printf("Ranks: %d, bands of %d-%d rows, %d-row halos\n", ranks, shape.height / ranks,
+               (shape.height + ranks - 1) / ranks, halo);
+        printf("Engine: %s\n", engine);
+        print_config(&config);
+        printf("\n");
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+
+    MPI_Scatterv(rank == 0 ? full->data : NULL, counts, displs, row_type, band, band_rows, row_type, 0,
+                 MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+
+    // Halo exchange: the first rows of my band go up as the upper neighbour's bottom halo
+    // while its last rows arrive as my top halo, then the same downwards
+    int up = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    int down = rank < ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+    MPI_Sendrecv(band, halo_top, row_type, up, 0,
+                 band + (long)band_rows * row_bytes, halo_bottom, row_type, down, 0,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(band + (long)(band_rows - halo_bottom) * row_bytes, halo_bottom, row_type, down, 1,
+                 local_in->data, halo_top, row_type, up, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    double t2 = MPI_Wtime();
+
+    if (strcmp(engine, "separable") == 0) {
+        convolve_separable(local_in, local_out, taps, kernel_size, &config);
+    } else if (!convolve_direct(local_in, local_out, kernel, kernel_size, strcmp(engine, "recursive") == 0, NULL,
+                                &config)) {
+        fprintf(stderr, "Rank %d: failed to convolve band\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    double t3 = MPI_Wtime();
+
+    // Band rows only; the halo rows' outputs are incomplete and dropped
+    Image* output = NULL;
+    if (rank == 0) {
+        output = create_image_typed(shape.width, shape.height, shape.channels, (PixelType)shape.type);
+        if (!output) {
+            fprintf(stderr, "Failed to create output image\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gatherv(local_out->data + halo_top * row_bytes, band_rows, row_type, rank == 0 ? output->data : NULL,
+                counts, displs, row_type, 0, MPI_COMM_WORLD);
+    double t4 = MPI_Wtime();
+
+    // Slowest rank per phase
+    double local[4] = {t1 - t0, t2 - t1, t3 - t2, t4 - t3};
+    double slowest[4];
+    MPI_Reduce(local, slowest, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    int ok = 1;
+    if (rank == 0) {
+        printf("Scatter time: %.6f seconds\n", slowest[0]);
+        printf("Halo exchange time: %.6f seconds\n", slowest[1]);
+        printf("Compute time: %.6f seconds (slowest rank)\n", slowest[2]);
+        printf("Gather time: %.6f seconds\n", slowest[3]);
+        printf("Parallel time: %.6f seconds\n", t4 - t0);
+        printf("Threads used: %d ranks x %d threads\n", ranks, config.num_threads);
+
+        printf("\nSaving output image...\n");
+        ok = save_image(output_file, output);
+        if (ok) printf("\nConvolution completed successfully!\n");
+    }
+
+    free_kernel(kernel, kernel_size);
+    free(taps);
+    free_image(local_in);
+    free_image(local_out);
+    free_image(output);
+    free_image(full);
+    free(counts);
+    free(displs);
+    MPI_Type_free(&row_type);
+    MPI_Finalize();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Raw syscalls keep libnuma out of the build; constants from <linux/mempolicy.h>
+#define NUMA_MPOL_BIND 2
+#define NUMA_MAX_NODES 64
+#define NUMA_MAX_CPUS 4096
+
+static int node_count = 0;
+static short cpu_node[NUMA_MAX_CPUS];
+
+// Build the cpu -> node table from /sys/devices/system/node/node*/cpulist (once)
+static void numa_init(void) {
+    if (node_count > 0) return;
+
+    memset(cpu_node, 0, sizeof(cpu_node));
+    int nodes = 0;
+    for (int n = 0; n < NUMA_MAX_NODES; n++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+        FILE* f = fopen(path, "r");
+        if (!f) continue;
+
+        // "0-3,8-11"
+        int lo, hi;
+        char sep;
+        while (fscanf(f, "%d", &lo) == 1) {
+            hi = lo;
+            if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+                if (fscanf(f, "%d", &hi) != 1) break;
+                if (fscanf(f, "%c", &sep) != 1) sep = '\n';
+            }
+            for (int c = lo; c <= hi && c < NUMA_MAX_CPUS; c++) cpu_node[c] = (short)n;
+            if (sep != ',') break;
+        }
+        fclose(f);
+        nodes = n + 1;
+    }
+    node_count = nodes > 0 ? nodes : 1;
+}
+
+int numa_node_count(void) {
+    numa_init();
+    return node_count;
+}
+
+// Node of the CPU the calling thread is running on
+int numa_current_node(void) {
+    numa_init();
+    int cpu = sched_getcpu();
+    return cpu >= 0 && cpu < NUMA_MAX_CPUS ? cpu_node[cpu] : 0;
+}
+
+// Page-aligned, untouched image storage (pages are placed when first written)
+static Image* alloc_image_untouched(int width, int height, int channels, PixelType type) {
+    Image* img = (Image*)malloc(sizeof(Image));
+    if (!img) return NULL;
+
+    img->width = width;
+    img->height = height;
+    img->channels = channels;
+    img->type = type;
+
+    void* data = NULL;
+    size_t bytes = (size_t)width * height * channels * pixel_size(type);
+    if (posix_memalign(&data, (size_t)sysconf(_SC_PAGESIZE), bytes ? bytes : 1) != 0) {
+        fprintf(stderr, "Failed to allocate memory for image data\n");
+        free(img);
+        return NULL;
+    }
+    img->data = (uint8_t*)data;
+    return img;
+}
+
+// Zero (src == NULL) or copy the rows of dst with the engines' static row partition, so
+// each page is first touched by the thread (and node) that will process those rows
+static void touch_rows(Image* dst, const Image* src, ConvConfig* config) {
+    long row_bytes = (long)dst->width * dst->channels * pixel_size(dst->type);
+    int chunk = config->chunk_size > 0 ? config->chunk_size : 1;
+
+    omp_set_num_threads(config->num_threads);
+
+    #pragma omp parallel for schedule(static, chunk)
+    for (int y = 0; y < dst->height; y++) {
+        if (src) {
+            memcpy(dst->data + y * row_bytes, src->data + y * row_bytes, row_bytes);
+        } else {
+            memset(dst->data + y * row_bytes, 0, row_bytes);
+        }
+    }
+}
+
+// Zeroed image whose pages are first touched under the engines' row partition
+Image* create_image_first_touch(int width, int height, int channels, PixelType type, ConvConfig* config) {
+    Image* img = alloc_image_untouched(width, height, channels, type);
+    if (img) touch_rows(img, NULL, config);
+    return img;
+}
+
+// Copy of src (e.g. a freshly decoded image, which lives on the main thread's node)
+// with pages first touched under the engines' row partition
+Image* copy_image_first_touch(Image* src, ConvConfig* config) {
+    Image* img = alloc_image_untouched(src->width, src->height, src->channels, src->type);
+    if (img) touch_rows(img, src, config);
+    return img;
+}
+
+// One read-only copy of src per node, each bound to its node with mbind
+ImageReplicas* replicate_image(Image* src, ConvConfig* config) {
+    ImageReplicas* r = (ImageReplicas*)malloc(sizeof(ImageReplicas));
+    if (!r) return NULL;
+
+    r->nodes = numa_node_count();
+    r->copy = (Image**)calloc(r->nodes, sizeof(Image*));
+    if (!r->copy) {
+        free(r);
+        return NULL;
+    }
+
+    size_t bytes = (size_t)src->width * src->height * src->channels * pixel_size(src->type);
+    for (int n = 0; n < r->nodes; n++) {
+        Image* img = alloc_image_untouched(src->width, src->height, src->channels, src->type);
+        if (!img) {
+            free_image_replicas(r);
+            return NULL;
+        }
+
+        unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long)) + 1] = {0};
+        mask[n / (8 * sizeof(unsigned long))] = 1ul << (n % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_mbind, img->data, bytes, NUMA_MPOL_BIND, mask, NUMA_MAX_NODES + 1, 0) != 0 &&
+            r->nodes > 1) {
+            fprintf(stderr, "Warning: mbind failed for node %d, replica placed by first touch\n", n);
+        }
+
+        touch_rows(img, src, config);
+        r->copy[n] = img;
+    }
+    return r;
+}
+
+void free_image_replicas(ImageReplicas* r) {
+    if (r) {
+        for (int n = 0; n < r->nodes; n++) {
+            free_image(r->copy[n]);
+        }
+        free(r->copy);
+        free(r);
+    }
+}
+
+// Direct convolution where every thread reads the input replica on its own node.
+// Rows use the same schedule(static, chunk) partition as first touch; each source row is
+// loaded once into a zero-padded float row and all kernel columns are applied to it.
+// Returns 0 if the per-thread rows cannot be allocated.
+int convolve_openmp_replicated(ImageReplicas* input, Image* output, float** kernel, int kernel_size,
+                               ConvConfig* config) {
+    Image* first = input->copy[0];
+    int width = first->width;
+    int height = first->height;
+    int channels = first->channels;
+    int half_kernel = kernel_size / 2;
+    long row_len = (long)width * channels;
+    long pad = (long)half_kernel * channels;
+    int chunk = config->chunk_size > 0 ? config->chunk_size : 1;
+
+    omp_set_num_threads(config->num_threads);
+
+    int failed = 0;
+    #pragma omp parallel reduction(+:failed)
+    {
+        Image* in = input->copy[numa_current_node() % input->nodes];
+        float* padded = (float*)calloc(row_len + 2 * pad, sizeof(float));
+        float* acc = (float*)malloc(row_len * sizeof(float));
+        int ok = padded && acc;
+        failed += !ok;
+
+        #pragma omp for schedule(static, chunk)
+        for (int y = 0; y < height; y++) {
+            if (!ok) continue;
+            memset(acc, 0, row_len * sizeof(float));
+            for (int ky = 0; ky < kernel_size; ky++) {
+                int src_y = y + ky - half_kernel;
+                if (src_y < 0 || src_y >= height) continue;
+                load_row_float(in, src_y * row_len, padded + pad, row_len);
+                for (int kx = 0; kx < kernel_size; kx++) {
+                    float w = kernel[ky][kx];
+                    const float* s = padded + kx * channels;
+                    #pragma omp simd
+                    for (long i = 0; i < row_len; i++) acc[i] += w * s[i];
+                }
+            }
+            // Integer outputs truncate like the direct engines (store_row_float rounds)
+            if (output->type == PIXEL_U8 || output->type == PIXEL_U16) {
+                for (long i = 0; i < row_len; i++) acc[i] = floorf(acc[i]);
+            }
+            store_row_float(acc, output, y * row_len, row_len);
+        }
+
+        free(padded);
+        free(acc);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to allocate replicated convolution rows\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Print how an image's pages are spread over nodes (move_pages with no target nodes
+// only queries placement). Pages not yet touched are counted separately.
+void report_page_placement(const char* label, Image* img) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t bytes = (size_t)img->width * img->height * img->channels * pixel_size(img->type);
+    uintptr_t start = (uintptr_t)img->data & ~(uintptr_t)(page - 1);
+    long count = (long)(((uintptr_t)img->data + bytes - start + page - 1) / page);
+
+    void** pages = (void**)malloc(count * sizeof(void*));
+    int* status = (int*)malloc(count * sizeof(int));
+    if (!pages || !status) {
+        free(pages);
+        free(status);
+        return;
+    }
+    for (long i = 0; i < count; i++) pages[i] = (void*)(start + i * page);
+
+    if (syscall(SYS_move_pages, 0, count, pages, NULL, status, 0) != 0) {
+        printf("  %s: page placement unavailable\n", label);
+    } else {
+        long per_node[NUMA_MAX_NODES] = {0};
+        long other = 0;
+        for (long i = 0; i < count; i++) {
+            if (status[i] >= 0 && status[i] < NUMA_MAX_NODES) per_node[status[i]]++;
+            else other++;
+        }
+
+        printf("  %s: %ld pages", label, count);
+        for (int n = 0; n < numa_node_count(); n++) {
+            printf(", node%d %.1f%%", n, 100.0 * per_node[n] / count);
+        }
+        if (other) printf(", not present %.1f%%", 100.0 * other / count);
+        printf("\n");
+    }
+
+    free(pages);
+    free(status);
+}
@@ -0,0 +1,584 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Rows per band, the unit of work and of synchronization between stages
+#define PIPELINE_DEFAULT_BAND 16
+
+// Spins before a waiting thread starts yielding its core
+#define PIPELINE_SPIN_LIMIT 1024
+
+// Parse "name[:arg],name[:arg],...". Stages: gaussian:k, box:k, sobel, threshold:t
+Pipeline* parse_pipeline(const char* spec) {
+    Pipeline* p = (Pipeline*)calloc(1, sizeof(Pipeline));
+    if (!p) return NULL;
+
+    int max_stages = 1;
+    for (const char* c = spec; *c; c++) max_stages += *c == ',';
+    p->stage = (PipelineStage*)calloc(max_stages, sizeof(PipelineStage));
+    if (!p->stage) {
+        free(p);
+        return NULL;
+    }
+
+    const char* c = spec;
+    while (*c) {
+        int len = (int)strcspn(c, ",");
+        char name[32] = "";
+        char arg[32] = "";
+        int name_len = (int)strcspn(c, ":,");
+        snprintf(name, sizeof(name), "%.*s", name_len, c);
+        if (name_len < len) snprintf(arg, sizeof(arg), "%.*s", len - name_len - 1, c + name_len + 1);
+
+        PipelineStage* st = &p->stage[p->count];
+        int ok = 1;
+        if (strcmp(name, "gaussian") == 0 || strcmp(name, "box") == 0) {
+            int size = arg[0] ? atoi(arg) : 3;
+            ok = size >= 1 && size % 2 == 1;
+            if (ok) {
+                st->type = name[0] == 'g' ? STAGE_GAUSSIAN : STAGE_BOX;
+                st->radius = size / 2;
+                st->taps = st->type == STAGE_GAUSSIAN ? create_gaussian_taps(size, size / 6.0f)
+                                                      : create_box_taps(size);
+                ok = st->taps != NULL;
+            }
+        } else if (strcmp(name, "sobel") == 0) {
+            st->type = STAGE_SOBEL;
+            st->radius = 1;
+        } else if (strcmp(name, "threshold") == 0) {
+            st->type = STAGE_THRESHOLD;
+            st->radius = 0;
+            st->param = arg[0] ? (float)atof(arg) : 128.0f;
+        } else {
+            ok = 0;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "Invalid pipeline stage: %.*s\n", len, c);
+            free_pipeline(p);
+            return NULL;
+        }
+        p->count++;
+
+        c += len;
+        if (*c == ',') c++;
+    }
+
+    if (p->count == 0) {
+        fprintf(stderr, "Empty pipeline\n");
+        free_pipeline(p);
+        return NULL;
+    }
+    return p;
+}
+
+void free_pipeline(Pipeline* p) {
+    if (p) {
+        for (int i = 0; i < p->count; i++) {
+            free(p->stage[i].taps);
+        }
+        free(p->stage);
+        free(p);
+    }
+}
+
+const char* stage_name(const PipelineStage* st) {
+    static const char* names[] = {"gaussian", "box", "sobel", "threshold"};
+    return names[st->type];
+}
+
+// Compute output row y of a stage from its input image. range is the full-scale value of
+// the data (threshold output level). scratch holds at least (width + 2 * radius + 2) *
+// channels * 3 floats.
+void pipeline_stage_row(const PipelineStage* st, const Image* in, int y, float range, float* out,
+                        float* scratch) {
+    int width = in->width;
+    int height = in->height;
+    int channels = in->channels;
+    long row_len = (long)width * channels;
+    int r = st->radius;
+
+    switch (st->type) {
+    case STAGE_GAUSSIAN:
+    case STAGE_BOX: {
+        // Vertical taps into a zero-padded row, then horizontal taps
+        float* padded = scratch;
+        memset(padded, 0, (row_len + 2L * r * channels) * sizeof(float));
+        for (int k = -r; k <= r; k++) {
+            if (y + k >= 0 && y + k < height) {
+                accumulate_row(padded + r * channels, in, (long)(y + k) * row_len, st->taps[k + r], row_len);
+            }
+        }
+        memset(out, 0, row_len * sizeof(float));
+        for (int k = 0; k <= 2 * r; k++) {
+            float w = st->taps[k];
+            const float* s = padded + k * channels;
+            #pragma omp simd
+            for (long i = 0; i < row_len; i++) out[i] += w * s[i];
+        }
+        break;
+    }
+    case STAGE_SOBEL: {
+        // Gradient magnitude per channel from three zero-padded rows
+        long padded_len = row_len + 2L * channels;
+        float* rows[3] = {scratch, scratch + padded_len, scratch + 2 * padded_len};
+        for (int k = 0; k < 3; k++) {
+            memset(rows[k], 0, padded_len * sizeof(float));
+            if (y + k - 1 >= 0 && y + k - 1 < height) {
+                load_row_float(in, (long)(y + k - 1) * row_len, rows[k] + channels, row_len);
+            }
+        }
+        const float* a = rows[0];
+        const float* b = rows[1];
+        const float* c = rows[2];
+        long c2 = 2L * channels;
+        for (long i = 0; i < row_len; i++) {
+            float gx = (a[i + c2] + 2.0f * b[i + c2] + c[i + c2]) - (a[i] + 2.0f * b[i] + c[i]);
+            float gy = (c[i] + 2.0f * c[i + channels] + c[i + c2]) - (a[i] + 2.0f * a[i + channels] + a[i + c2]);
+            out[i] = sqrtf(gx * gx + gy * gy);
+        }
+        break;
+    }
+    case STAGE_THRESHOLD:
+        load_row_float(in, (long)y * row_len, out, row_len);
+        for (long i = 0; i < row_len; i++) {
+            out[i] = out[i] >= st->param ? range : 0.0f;
+        }
+        break;
+    }
+}
+
+// pipeline_stage_row for a stage whose input rows y-r..y+r are given as float lines
+// (NULL outside the image). Same arithmetic in the same order, so the results match.
+static void stage_row_from_lines(const PipelineStage* st, const float* const* lines, long row_len, int channels,
+                                 float range, float* out, float* scratch) {
+    int r = st->radius;
+
+    switch (st->type) {
+    case STAGE_GAUSSIAN:
+    case STAGE_BOX: {
+        float* padded = scratch;
+        float* acc = padded + r * channels;
+        memset(padded, 0, (row_len + 2L * r * channels) * sizeof(float));
+        for (int k = 0; k <= 2 * r; k++) {
+            if (lines[k]) {
+                float w = st->taps[k];
+                const float* src = lines[k];
+                #pragma omp simd
+                for (long i = 0; i < row_len; i++) acc[i] += w * src[i];
+            }
+        }
+        memset(out, 0, row_len * sizeof(float));
+        for (int k = 0; k <= 2 * r; k++) {
+            float w = st->taps[k];
+            const float* s = padded + k * channels;
+            #pragma omp simd
+            for (long i = 0; i < row_len; i++) out[i] += w * s[i];
+        }
+        break;
+    }
+    case STAGE_SOBEL: {
+        long padded_len = row_len + 2L * channels;
+        float* rows[3] = {scratch, scratch + padded_len, scratch + 2 * padded_len};
+        for (int k = 0; k < 3; k++) {
+            memset(rows[k], 0, padded_len * sizeof(float));
+            if (lines[k]) memcpy(rows[k] + channels, lines[k], row_len * sizeof(float));
+        }
+        const float* a = rows[0];
+        const float* b = rows[1];
+        const float* c = rows[2];
+        long c2 = 2L * channels;
+        for (long i = 0; i < row_len; i++) {
+            float gx = (a[i + c2] + 2.0f * b[i + c2] + c[i + c2]) - (a[i] + 2.0f * b[i] + c[i]);
+            float gy = (c[i] + 2.0f * c[i + channels] + c[i + c2]) - (a[i] + 2.0f * a[i + channels] + a[i + c2]);
+            out[i] = sqrtf(gx * gx + gy * gy);
+        }
+        break;
+    }
+    case STAGE_THRESHOLD:
+        for (long i = 0; i < row_len; i++) {
+            out[i] = lines[0][i] >= st->param ? range : 0.0f;
+        }
+        break;
+    }
+}
+
+// One thread's line buffers for EXEC_STREAM. ring[s] holds the last 2 * r_s + 1 input
+// rows of stage s (stage 0's are converted input rows); lo[s]..hi[s] are the input rows
+// stage s needs for this band and next[s] is the next output row it will produce.
+typedef struct {
+    Pipeline* p;
+    Image* output;
+    int height;
+    long row_len;
+    int channels;
+    float range;
+    float** ring;
+    int* lo;
+    int* hi;
+    int* next;
+    const float** lines;
+    float* row;
+    float* scratch;
+} LineBuffers;
+
+static float* ring_row(LineBuffers* lb, int s, int y) {
+    return lb->ring[s] + (long)(y % (2 * lb->p->stage[s].radius + 1)) * lb->row_len;
+}
+
+// Row y of stage s's input has just been written to its ring: produce every output row
+// of stage s that is now complete and push it on to stage s + 1 (or into output)
+static void push_line(LineBuffers* lb, int s, int y) {
+    const PipelineStage* st = &lb->p->stage[s];
+    int r = st->radius;
+    int last = s == lb->p->count - 1;
+
+    while (lb->next[s] <= lb->hi[s + 1]) {
+        int yo = lb->next[s];
+        int need = yo + r < lb->height - 1 ? yo + r : lb->height - 1;
+        if (need > y) break;
+
+        for (int k = -r; k <= r; k++) {
+            int yi = yo + k;
+            lb->lines[k + r] = yi >= 0 && yi < lb->height ? ring_row(lb, s, yi) : NULL;
+        }
+        float* out = last ? lb->row : ring_row(lb, s + 1, yo);
+        stage_row_from_lines(st, lb->lines, lb->row_len, lb->channels, lb->range, out, lb->scratch);
+        lb->next[s]++;
+
+        if (last) {
+            store_row_float(out, lb->output, (long)yo * lb->row_len, lb->row_len);
+        } else {
+            push_line(lb, s + 1, yo);
+        }
+    }
+}
+
+// Streaming executor for EXEC_STREAM. The output is cut into independent horizontal
+// bands, one per thread by default (-B sets the band height). Each thread streams its
+// band in row order: an input row is converted into stage 0's ring, and every stage
+// emits an output row into the next stage's ring as soon as the rows under its window
+// have arrived. A stage keeps only 2r + 1 rows, so the working set is
+// O(width * total kernel height) per thread instead of one image per stage. Bands
+// recompute the earlier stages' rows in their halo (sum of the later radii) so they
+// need no synchronization. Returns the line buffer bytes per thread, or -1.
+static long run_pipeline_stream(Pipeline* p, Image* input, Image* output, int band_rows, float range,
+                                long scratch_len, int num_threads, int* bands_out) {
+    int height = input->height;
+    int channels = input->channels;
+    long row_len = (long)input->width * channels;
+    int count = p->count;
+    int band = band_rows > 0 ? band_rows : (height + num_threads - 1) / num_threads;
+    int num_bands = (height + band - 1) / band;
+    int max_radius = 0;
+    long ring_rows = 0;
+    int failed = 0;
+
+    for (int s = 0; s < count; s++) {
+        ring_rows += 2 * p->stage[s].radius + 1;
+        if (p->stage[s].radius > max_radius) max_radius = p->stage[s].radius;
+    }
+    *bands_out = num_bands;
+
+    omp_set_num_threads(num_threads);
+
+    #pragma omp parallel reduction(+:failed)
+    {
+        LineBuffers lb = {
+            .p = p,
+            .output = output,
+            .height = height,
+            .row_len = row_len,
+            .channels = channels,
+            .range = range
+        };
+        lb.ring = (float**)calloc(count, sizeof(float*));
+        lb.lo = (int*)malloc((count + 1) * sizeof(int));
+        lb.hi = (int*)malloc((count + 1) * sizeof(int));
+        lb.next = (int*)malloc(count * sizeof(int));
+        lb.lines = (const float**)malloc((2 * max_radius + 1) * sizeof(float*));
+        lb.row = (float*)malloc(row_len * sizeof(float));
+        lb.scratch = (float*)malloc(scratch_len * sizeof(float));
+        float* rings = (float*)malloc(ring_rows * row_len * sizeof(float));
+        int ok = lb.ring && lb.lo && lb.hi && lb.next && lb.lines && lb.row && lb.scratch && rings;
+
+        if (ok) {
+            float* base = rings;
+            for (int s = 0; s < count; s++) {
+                lb.ring[s] = base;
+                base += (2L * p->stage[s].radius + 1) * row_len;
+            }
+        }
+        failed += !ok;
+
+        #pragma omp for schedule(dynamic)
+        for (int b = 0; b < num_bands; b++) {
+            if (!ok) continue;
+
+            // Rows each stage needs for this band, from the output back to the input
+            lb.lo[count] = b * band;
+            lb.hi[count] = (b + 1) * band < height ? (b + 1) * band - 1 : height - 1;
+            for (int s = count - 1; s >= 0; s--) {
+                int r = p->stage[s].radius;
+                lb.lo[s] = lb.lo[s + 1] - r > 0 ? lb.lo[s + 1] - r : 0;
+                lb.hi[s] = lb.hi[s + 1] + r < height - 1 ? lb.hi[s + 1] + r : height - 1;
+                lb.next[s] = lb.lo[s + 1];
+            }
+
+            for (int y = lb.lo[0]; y <= lb.hi[0]; y++) {
+                load_row_float(input, (long)y * row_len, ring_row(&lb, 0, y), row_len);
+                push_line(&lb, 0, y);
+            }
+        }
+
+        free(rings);
+        free(lb.ring);
+        free(lb.lo);
+        free(lb.hi);
+        free(lb.next);
+        free(lb.lines);
+        free(lb.row);
+        free(lb.scratch);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to allocate pipeline line buffers\n");
+        return -1;
+    }
+    return ring_rows * row_len * (long)sizeof(float);
+}
+
+// Wait until a band's progress flag is set; yields once the spin budget is spent
+static void wait_for_band(const int* flag) {
+    int spins = 0;
+    int done;
+    for (;;) {
+        #pragma omp atomic read acquire
+        done = *flag;
+        if (done) return;
+        if (++spins > PIPELINE_SPIN_LIMIT) sched_yield();
+    }
+}
+
+// Task graph over (stage, band) for EXEC_TASKS. Stage s on band b depends on the bands
+// first..last of stage s-1 that cover its rows plus the stage radius, expressed as
+// depend(iterator) on one token per (stage, band). Tasks are generated in a wavefront:
+// step k creates band k - lag[s] of every stage s, where lag[s] is how many bands stage s
+// trails stage s-1, so a band of the next stage enters the graph as soon as its inputs
+// have and tends to run while they are still in cache. Returns the number of tasks.
+static int run_pipeline_tasks(Pipeline* p, Image* input, Image** buffer, int band, int num_bands,
+                              float range, long scratch_len, int num_threads) {
+    int width = input->width;
+    int height = input->height;
+    long row_len = (long)width * input->channels;
+    int count = p->count;
+    char* token = (char*)calloc((size_t)count * num_bands, 1);
+    int* lag = (int*)calloc(count, sizeof(int));
+    float** scratch = (float**)calloc(num_threads, sizeof(float*));
+    float** row = (float**)calloc(num_threads, sizeof(float*));
+    int tasks = 0;
+    int ok = token && lag && scratch && row;
+
+    for (int t = 0; ok && t < num_threads; t++) {
+        scratch[t] = (float*)malloc(scratch_len * sizeof(float));
+        row[t] = (float*)malloc(row_len * sizeof(float));
+        ok = scratch[t] && row[t];
+    }
+    if (ok) {
+        for (int s = 1; s < count; s++) {
+            lag[s] = lag[s - 1] + (p->stage[s].radius + band - 1) / band;
+        }
+    } else {
+        fprintf(stderr, "Failed to allocate pipeline task state\n");
+    }
+
+    #pragma omp parallel num_threads(num_threads) proc_bind(close) if (ok)
+    #pragma omp single
+    {
+        for (int step = 0; ok && step < num_bands + lag[count - 1]; step++) {
+            for (int s = 0; s < count; s++) {
+                int b = step - lag[s];
+                if (b < 0 || b >= num_bands) continue;
+
+                const PipelineStage* st = &p->stage[s];
+                Image* in = s == 0 ? input : buffer[s - 1];
+                Image* out = buffer[s];
+                int y0 = b * band;
+                int y1 = y0 + band < height ? y0 + band : height;
+                int first = (y0 - st->radius < 0 ? 0 : y0 - st->radius) / band;
+                int last = (y1 - 1 + st->radius >= height ? height - 1 : y1 - 1 + st->radius) / band;
+                long prev = s > 0 ? (long)(s - 1) * num_bands : 0;
+                long self = (long)s * num_bands + b;
+
+                // Stage 0 reads the input, so it depends on nothing (first..last of a
+                // dummy range that no task writes)
+                if (s == 0) last = first - 1;
+
+                #pragma omp task firstprivate(st, in, out, y0, y1) \
+                                 depend(iterator(d = first:last + 1), in: token[prev + d]) \
+                                 depend(out: token[self])
+                {
+                    int t = omp_get_thread_num();
+                    for (int y = y0; y < y1; y++) {
+                        pipeline_stage_row(st, in, y, range, row[t], scratch[t]);
+                        store_row_float(row[t], out, (long)y * row_len, row_len);
+                    }
+                }
+                tasks++;
+            }
+        }
+    }
+
+    for (int t = 0; t < num_threads && scratch && row; t++) {
+        free(scratch[t]);
+        free(row[t]);
+    }
+    free(scratch);
+    free(row);
+    free(lag);
+    free(token);
+    return ok ? tasks : -1;
+}
+
+// Run a pipeline. Stage i reads stage i-1's float image (stage 0 reads input); the last
+// stage stores into output. Intermediates stay float in the input's native range.
+//
+// With EXEC_PERSISTENT the whole job runs in one parallel region (team created once,
+// proc_bind(close)). Every stage is a `for schedule(static) nowait` over bands of
+// ctx->band_rows rows, so a thread gets the same bands in every stage. Instead of a
+// barrier between stages, a band waits only for the bands of the previous stage that
+// cover its rows plus the stage radius, via per-band progress flags. Waits only point
+// at earlier stages, so they cannot form a cycle. With EXEC_REGIONS each stage is its
+// own parallel region with an implicit barrier (the fork/join baseline). EXEC_TASKS
+// builds a task graph over (stage, band), see run_pipeline_tasks. EXEC_STREAM keeps
+// only per-stage line buffers, see run_pipeline_stream.
+int run_pipeline(ExecContext* ctx, Pipeline* p, Image* input, Image* output, PipelineStats* stats) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    long row_len = (long)width * channels;
+    int band = ctx->band_rows > 0 ? ctx->band_rows : PIPELINE_DEFAULT_BAND;
+    int num_bands = (height + band - 1) / band;
+    static const float range_of[] = {255.0f, 65535.0f, 1.0f, 1.0f};
+    float range = range_of[input->type];
+
+    int max_radius = 0;
+    for (int s = 0; s < p->count; s++) {
+        if (p->stage[s].radius > max_radius) max_radius = p->stage[s].radius;
+    }
+    long scratch_len = 3 * (row_len + 2L * (max_radius + 1) * channels);
+
+    // stage s writes buffer[s]; buffer[count - 1] is output. Streaming needs no images.
+    int streaming = ctx->model == EXEC_STREAM;
+    Image** buffer = (Image**)calloc(p->count, sizeof(Image*));
+    int* done = (int*)calloc((size_t)p->count * num_bands, sizeof(int));
+    int ok = buffer && done;
+    for (int s = 0; ok && !streaming && s < p->count - 1; s++) {
+        buffer[s] = create_image_typed(width, height, channels, PIXEL_F32);
+        ok = buffer[s] != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate pipeline buffers\n");
+        if (buffer) {
+            for (int s = 0; s < p->count - 1; s++) free_image(buffer[s]);
+        }
+        free(buffer);
+        free(done);
+        return 0;
+    }
+    buffer[p->count - 1] = output;
+
+    int regions = 0;
+    int tasks = 0;
+    long buffer_bytes = (p->count - 1) * row_len * height * (long)sizeof(float);
+    double start_time = get_time();
+
+    if (streaming) {
+        regions = 1;
+        buffer_bytes = run_pipeline_stream(p, input, output, ctx->band_rows, range, scratch_len, ctx->num_threads,
+                                           &num_bands);
+        ok = buffer_bytes >= 0;
+    } else if (ctx->model == EXEC_TASKS) {
+        regions = 1;
+        tasks = run_pipeline_tasks(p, input, buffer, band, num_bands, range, scratch_len, ctx->num_threads);
+        ok = tasks >= 0;
+    } else if (ctx->model == EXEC_PERSISTENT) {
+        regions = 1;
+
+        #pragma omp parallel num_threads(ctx->num_threads) proc_bind(close)
+        {
+            float* scratch = (float*)malloc(scratch_len * sizeof(float));
+            float* row = (float*)malloc(row_len * sizeof(float));
+
+            for (int s = 0; s < p->count; s++) {
+                const PipelineStage* st = &p->stage[s];
+                Image* in = s == 0 ? input : buffer[s - 1];
+
+                #pragma omp for schedule(static) nowait
+                for (int b = 0; b < num_bands; b++) {
+                    int y0 = b * band;
+                    int y1 = y0 + band < height ? y0 + band : height;
+
+                    if (s > 0) {
+                        int first = (y0 - st->radius < 0 ? 0 : y0 - st->radius) / band;
+                        int last = (y1 - 1 + st->radius >= height ? height - 1 : y1 - 1 + st->radius) / band;
+                        for (int d = first; d <= last; d++) {
+                            wait_for_band(&done[(long)(s - 1) * num_bands + d]);
+                        }
+                    }
+
+                    for (int y = y0; y < y1; y++) {
+                        pipeline_stage_row(st, in, y, range, row, scratch);
+                        store_row_float(row, buffer[s], (long)y * row_len, row_len);
+                    }
+
+                    #pragma omp atomic write release
+                    done[(long)s * num_bands + b] = 1;
+                }
+            }
+
+            free(scratch);
+            free(row);
+        }
+    } else {
+        for (int s = 0; s < p->count; s++) {
+            const PipelineStage* st = &p->stage[s];
+            Image* in = s == 0 ? input : buffer[s - 1];
+            regions++;
+
+            omp_set_num_threads(ctx->num_threads);
+
+            #pragma omp parallel
+            {
+                float* scratch = (float*)malloc(scratch_len * sizeof(float));
+                float* row = (float*)malloc(row_len * sizeof(float));
+
+                #pragma omp for schedule(static)
+                for (int y = 0; y < height; y++) {
+                    pipeline_stage_row(st, in, y, range, row, scratch);
+                    store_row_float(row, buffer[s], (long)y * row_len, row_len);
+                }
+
+                free(scratch);
+                free(row);
+            }
+        }
+    }
+
+    if (stats) {
+        stats->elapsed = get_time() - start_time;
+        stats->regions = regions;
+        stats->bands = num_bands;
+        stats->tasks = tasks > 0 ? tasks : 0;
+        stats->buffer_bytes = buffer_bytes;
+    }
+
+    for (int s = 0; s < p->count - 1; s++) free_image(buffer[s]);
+    free(buffer);
+    free(done);
+    return ok;
+}
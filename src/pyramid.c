@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+// 5-tap binomial filter [1 4 6 4 1] / 16 used for reduce
+static const float reduce_taps[5] = {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f};
+
+static inline int clamp_index(int i, int n) {
+    return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+// Blur with the binomial filter and decimate by 2 in both directions. Returns NULL if
+// the level or its scratch rows cannot be allocated
+FloatImage* pyramid_reduce(FloatImage* src, ConvConfig* config) {
+    int width = src->width;
+    int height = src->height;
+    int channels = src->channels;
+    int out_w = (width + 1) / 2;
+    int out_h = (height + 1) / 2;
+    int row_len = width * channels;
+
+    FloatImage* dst = create_float_image(out_w, out_h, channels);
+    if (!dst) return NULL;
+
+    omp_set_num_threads(config->num_threads);
+
+    int failed = 0;
+    #pragma omp parallel reduction(+:failed)
+    {
+        // Vertically filtered fine row, reused for every coarse row of this thread
+        float* vrow = (float*)malloc(row_len * sizeof(float));
+        failed += !vrow;
+
+        #pragma omp for schedule(static)
+        for (int oy = 0; oy < out_h; oy++) {
+            if (!vrow) continue;
+            const float* rows[5];
+            for (int m = 0; m < 5; m++) {
+                rows[m] = src->data + (long)clamp_index(2 * oy + m - 2, height) * row_len;
+            }
+
+            for (int i = 0; i < row_len; i++) {
+                vrow[i] = reduce_taps[0] * rows[0][i] + reduce_taps[1] * rows[1][i] +
+                          reduce_taps[2] * rows[2][i] + reduce_taps[3] * rows[3][i] +
+                          reduce_taps[4] * rows[4][i];
+            }
+
+            float* out_row = dst->data + (long)oy * out_w * channels;
+            for (int ox = 0; ox < out_w; ox++) {
+                for (int c = 0; c < channels; c++) {
+                    float sum = 0.0f;
+                    for (int m = 0; m < 5; m++) {
+                        int x = clamp_index(2 * ox + m - 2, width);
+                        sum += reduce_taps[m] * vrow[x * channels + c];
+                    }
+                    out_row[ox * channels + c] = sum;
+                }
+            }
+        }
+
+        free(vrow);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to allocate pyramid scratch rows\n");
+        free_float_image(dst);
+        return NULL;
+    }
+    return dst;
+}
+
+// Horizontally expand one coarse row to the fine width
+static void expand_row(const float* coarse, int coarse_w, float* fine, int fine_w, int channels) {
+    for (int x = 0; x < fine_w; x++) {
+        int i = x >> 1;
+        const float* c0 = coarse + clamp_index(i, coarse_w) * channels;
+        const float* c1 = coarse + clamp_index(i + 1, coarse_w) * channels;
+        float* out = fine + x * channels;
+
+        if (x & 1) {
+            for (int c = 0; c < channels; c++) {
+                out[c] = 0.5f * (c0[c] + c1[c]);
+            }
+        } else {
+            const float* cm = coarse + clamp_index(i - 1, coarse_w) * channels;
+            for (int c = 0; c < channels; c++) {
+                out[c] = 0.125f * (cm[c] + c1[c]) + 0.75f * c0[c];
+            }
+        }
+    }
+}
+
+// Rows per band so the fine rows and the expanded coarse rows stay in L2
+static int expand_band_rows(int fine_w, int channels) {
+    long row_bytes = (long)fine_w * channels * sizeof(float);
+    // Per fine row: source + destination, plus half a row of expanded coarse data
+    int rows = (int)(cache_size(2) / (row_bytes * 5 / 2));
+    rows &= ~1;
+    return rows < 2 ? 2 : rows;
+}
+
+// Fused upsample-and-combine: dst = src + sign * expand(coarse).
+// dst may alias src. When dst_u8 is given the result is written there instead of dst.
+// Returns 0 if the scratch rows cannot be allocated.
+static int expand_combine(FloatImage* coarse, const float* src, float* dst, uint8_t* dst_u8,
+                           int fine_w, int fine_h, float sign, ConvConfig* config) {
+    int channels = coarse->channels;
+    int row_len = fine_w * channels;
+    int band = expand_band_rows(fine_w, channels);
+    int num_bands = (fine_h + band - 1) / band;
+
+    omp_set_num_threads(config->num_threads);
+
+    int failed = 0;
+    #pragma omp parallel reduction(+:failed)
+    {
+        // Horizontally expanded coarse rows covering one band (plus one row on each side)
+        float* hrows = (float*)malloc((long)(band / 2 + 3) * row_len * sizeof(float));
+        failed += !hrows;
+
+        #pragma omp for schedule(static)
+        for (int b = 0; b < num_bands; b++) {
+            if (!hrows) continue;
+            int y_start = b * band;
+            int y_end = (y_start + band < fine_h) ? y_start + band : fine_h;
+            int cy_first = y_start / 2 - 1;
+            int cy_last = (y_end - 1) / 2 + 1;
+
+            for (int cy = cy_first; cy <= cy_last; cy++) {
+                const float* crow = coarse->data + (long)clamp_index(cy, coarse->height) * coarse->width * channels;
+                expand_row(crow, coarse->width, hrows + (long)(cy - cy_first) * row_len, fine_w, channels);
+            }
+
+            for (int y = y_start; y < y_end; y++) {
+                int j = (y >> 1) - cy_first;
+                const float* h0 = hrows + (long)j * row_len;
+                const float* h1 = hrows + (long)(j + 1) * row_len;
+                const float* in = src + (long)y * row_len;
+                long base = (long)y * row_len;
+
+                if (y & 1) {
+                    if (dst_u8) {
+                        for (int i = 0; i < row_len; i++) {
+                            float v = in[i] + sign * 0.5f * (h0[i] + h1[i]);
+                            dst_u8[base + i] = (uint8_t)fminf(fmaxf(v + 0.5f, 0.0f), 255.0f);
+                        }
+                    } else {
+                        float* out = dst + base;
+                        for (int i = 0; i < row_len; i++) {
+                            out[i] = in[i] + sign * 0.5f * (h0[i] + h1[i]);
+                        }
+                    }
+                } else {
+                    const float* hm = hrows + (long)(j - 1) * row_len;
+                    if (dst_u8) {
+                        for (int i = 0; i < row_len; i++) {
+                            float v = in[i] + sign * (0.125f * (hm[i] + h1[i]) + 0.75f * h0[i]);
+                            dst_u8[base + i] = (uint8_t)fminf(fmaxf(v + 0.5f, 0.0f), 255.0f);
+                        }
+                    } else {
+                        float* out = dst + base;
+                        for (int i = 0; i < row_len; i++) {
+                            out[i] = in[i] + sign * (0.125f * (hm[i] + h1[i]) + 0.75f * h0[i]);
+                        }
+                    }
+                }
+            }
+        }
+
+        free(hrows);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to allocate pyramid scratch rows\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Build a Laplacian pyramid; each Gaussian level is turned into its band-pass level in place
+LaplacianPyramid* laplacian_decompose(Image* input, int levels, ConvConfig* config) {
+    // Stop once the residual is a single row or column
+    int max_levels = 1;
+    for (int w = input->width, h = input->height; w > 1 && h > 1; w = (w + 1) / 2, h = (h + 1) / 2) {
+        max_levels++;
+    }
+    if (levels > max_levels) levels = max_levels;
+    if (levels < 1) levels = 1;
+
+    LaplacianPyramid* pyr = (LaplacianPyramid*)malloc(sizeof(LaplacianPyramid));
+    if (!pyr) {
+        fprintf(stderr, "Failed to allocate memory for pyramid\n");
+        return NULL;
+    }
+    pyr->levels = levels;
+    pyr->level = (FloatImage**)calloc(levels, sizeof(FloatImage*));
+    if (!pyr->level) {
+        fprintf(stderr, "Failed to allocate memory for pyramid levels\n");
+        free(pyr);
+        return NULL;
+    }
+
+    pyr->level[0] = image_to_float(input);
+    if (!pyr->level[0]) {
+        free_laplacian_pyramid(pyr);
+        return NULL;
+    }
+
+    for (int i = 0; i + 1 < levels; i++) {
+        FloatImage* fine = pyr->level[i];
+        pyr->level[i + 1] = pyramid_reduce(fine, config);
+        if (!pyr->level[i + 1]) {
+            free_laplacian_pyramid(pyr);
+            return NULL;
+        }
+        if (!expand_combine(pyr->level[i + 1], fine->data, fine->data, NULL,
+                            fine->width, fine->height, -1.0f, config)) {
+            free_laplacian_pyramid(pyr);
+            return NULL;
+        }
+    }
+
+    return pyr;
+}
+
+// Collapse the pyramid into output; the pyramid itself is left unchanged. Returns 0 if
+// the scratch levels or rows cannot be allocated (output is then not fully written)
+int laplacian_reconstruct(LaplacianPyramid* pyr, Image* output, ConvConfig* config) {
+    FloatImage* coarse = pyr->level[pyr->levels - 1];
+    FloatImage* work[2] = {NULL, NULL};
+
+    // Levels 1..n-2 alternate between two scratch buffers sized for levels 1 and 2
+    for (int i = 1; i <= 2 && i <= pyr->levels - 2; i++) {
+        FloatImage* lap = pyr->level[i];
+        work[i & 1] = create_float_image(lap->width, lap->height, lap->channels);
+        if (!work[i & 1]) {
+            fprintf(stderr, "Failed to allocate memory for pyramid reconstruction\n");
+            free_float_image(work[0]);
+            free_float_image(work[1]);
+            return 0;
+        }
+    }
+
+    int ok = 1;
+    for (int i = pyr->levels - 2; ok && i >= 1; i--) {
+        FloatImage* lap = pyr->level[i];
+        FloatImage* dst = work[i & 1];
+        dst->width = lap->width;
+        dst->height = lap->height;
+
+        ok = expand_combine(coarse, lap->data, dst->data, NULL, lap->width, lap->height, 1.0f, config);
+        coarse = dst;
+    }
+
+    if (!ok) {
+        free_float_image(work[0]);
+        free_float_image(work[1]);
+        return 0;
+    }
+
+    FloatImage* lap0 = pyr->level[0];
+    if (pyr->levels == 1) {
+        float_to_image(lap0, output);
+    } else if (output->type == PIXEL_U8) {
+        ok = expand_combine(coarse, lap0->data, NULL, output->data, lap0->width, lap0->height, 1.0f, config);
+    } else {
+        // Wider sample types go through a float level 0
+        FloatImage* top = create_float_image(lap0->width, lap0->height, lap0->channels);
+        if (!top) {
+            fprintf(stderr, "Failed to allocate memory for pyramid reconstruction\n");
+            free_float_image(work[0]);
+            free_float_image(work[1]);
+            return 0;
+        }
+        ok = expand_combine(coarse, lap0->data, top->data, NULL, lap0->width, lap0->height, 1.0f, config);
+        if (ok) float_to_image(top, output);
+        free_float_image(top);
+    }
+
+    free_float_image(work[0]);
+    free_float_image(work[1]);
+    return ok;
+}
+
+// Scale the band-pass levels (detail enhancement for gain > 1)
+void laplacian_scale_details(LaplacianPyramid* pyr, float gain, ConvConfig* config) {
+    omp_set_num_threads(config->num_threads);
+
+    for (int i = 0; i + 1 < pyr->levels; i++) {
+        FloatImage* lap = pyr->level[i];
+        long n = (long)lap->width * lap->height * lap->channels;
+
+        #pragma omp parallel for schedule(static)
+        for (long j = 0; j < n; j++) {
+            lap->data[j] *= gain;
+        }
+    }
+}
+
+// Free pyramid memory
+void free_laplacian_pyramid(LaplacianPyramid* pyr) {
+    if (pyr) {
+        if (pyr->level) {
+            for (int i = 0; i < pyr->levels; i++) {
+                free_float_image(pyr->level[i]);
+            }
+            free(pyr->level);
+        }
+        free(pyr);
+    }
+}
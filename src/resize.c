@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+#define RESIZE_PI 3.14159265358979323846
+
+// Samples per side used to fold a Gaussian blur into the resampling taps
+#define BLUR_SAMPLES 12
+
+// Precomputed weights for one axis. Output positions repeat every `phases` outputs
+// shifted by `in_step` inputs, so only one weight row per phase is stored.
+typedef struct {
+    int out_len;
+    int taps;
+    int phases;
+    int* index;      // out_len x taps, clamped input index
+    float* weights;  // phases x taps, normalized
+} ResampleTable;
+
+static int gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double sinc(double x) {
+    if (fabs(x) < 1e-8) return 1.0;
+    x *= RESIZE_PI;
+    return sin(x) / x;
+}
+
+// Support of the filter in input pixels
+static double filter_support(ResizeFilter filter, double ratio) {
+    double fscale = ratio > 1.0 ? ratio : 1.0;
+    switch (filter) {
+        case RESIZE_LANCZOS3: return 3.0 * fscale;
+        case RESIZE_BICUBIC:  return 2.0 * fscale;
+        case RESIZE_AREA:     return 0.5 * ratio + 0.5;
+    }
+    return 1.0;
+}
+
+// Filter response at distance d (input pixels) from the output sample center
+static double filter_weight(ResizeFilter filter, double d, double ratio) {
+    double fscale = ratio > 1.0 ? ratio : 1.0;
+    double t = fabs(d) / fscale;
+
+    switch (filter) {
+        case RESIZE_LANCZOS3:
+            return t < 3.0 ? sinc(t) * sinc(t / 3.0) : 0.0;
+        case RESIZE_BICUBIC:
+            // Keys cubic, a = -0.5
+            if (t < 1.0) return (1.5 * t - 2.5) * t * t + 1.0;
+            if (t < 2.0) return ((-0.5 * t + 2.5) * t - 4.0) * t + 2.0;
+            return 0.0;
+        case RESIZE_AREA: {
+            // Overlap of the input pixel with the output pixel footprint
+            double half = 0.5 * ratio;
+            double lo = fmax(d - 0.5, -half);
+            double hi = fmin(d + 0.5, half);
+            return hi > lo ? hi - lo : 0.0;
+        }
+    }
+    return 0.0;
+}
+
+static void free_table(ResampleTable* t) {
+    free(t->index);
+    free(t->weights);
+}
+
+// Build the weight table for one axis; blur_sigma is in output pixels (0 = none)
+static int build_table(ResampleTable* t, int in_len, int out_len, ResizeFilter filter, float blur_sigma) {
+    double ratio = (double)in_len / out_len;
+    double sigma_in = blur_sigma * ratio;
+    double support = filter_support(filter, ratio) + 3.0 * sigma_in;
+    int g = gcd(in_len, out_len);
+
+    t->out_len = out_len;
+    t->taps = (int)ceil(2.0 * support) + 1;
+    t->phases = out_len / g;
+    int in_step = in_len / g;
+
+    t->index = (int*)malloc((size_t)out_len * t->taps * sizeof(int));
+    t->weights = (float*)malloc((size_t)t->phases * t->taps * sizeof(float));
+    int* first = (int*)malloc(t->phases * sizeof(int));
+    if (!t->index || !t->weights || !first) {
+        fprintf(stderr, "Failed to allocate resampling table\n");
+        free(first);
+        free_table(t);
+        return 0;
+    }
+
+    // Gaussian samples for folding the blur into the taps
+    double blur_w[2 * BLUR_SAMPLES + 1];
+    double blur_s[2 * BLUR_SAMPLES + 1];
+    int blur_n = 1;
+    blur_w[0] = 1.0;
+    blur_s[0] = 0.0;
+    if (sigma_in > 0.0) {
+        double total = 0.0;
+        blur_n = 2 * BLUR_SAMPLES + 1;
+        for (int k = 0; k < blur_n; k++) {
+            double s = (k - BLUR_SAMPLES) * 3.0 * sigma_in / BLUR_SAMPLES;
+            blur_s[k] = s;
+            blur_w[k] = exp(-s * s / (2.0 * sigma_in * sigma_in));
+            total += blur_w[k];
+        }
+        for (int k = 0; k < blur_n; k++) blur_w[k] /= total;
+    }
+
+    for (int p = 0; p < t->phases; p++) {
+        double center = (p + 0.5) * ratio - 0.5;
+        first[p] = (int)ceil(center - support);
+        float* w = t->weights + (size_t)p * t->taps;
+        double sum = 0.0;
+
+        for (int j = 0; j < t->taps; j++) {
+            double d = first[p] + j - center;
+            double v = 0.0;
+            for (int k = 0; k < blur_n; k++) {
+                v += blur_w[k] * filter_weight(filter, d - blur_s[k], ratio);
+            }
+            w[j] = (float)v;
+            sum += v;
+        }
+
+        if (sum != 0.0) {
+            for (int j = 0; j < t->taps; j++) w[j] = (float)(w[j] / sum);
+        }
+    }
+
+    for (int x = 0; x < out_len; x++) {
+        int start = first[x % t->phases] + (x / t->phases) * in_step;
+        for (int j = 0; j < t->taps; j++) {
+            int i = start + j;
+            t->index[(size_t)x * t->taps + j] = i < 0 ? 0 : (i >= in_len ? in_len - 1 : i);
+        }
+    }
+
+    free(first);
+    return 1;
+}
+
+// Resample rows to a new width; returns 0 if a thread's row buffers cannot be allocated
+static int horizontal_pass(Image* src, Image* dst, ResampleTable* t) {
+    int in_w = src->width;
+    int out_w = t->out_len;
+    int channels = src->channels;
+    int taps = t->taps;
+    int failed = 0;
+
+    #pragma omp parallel reduction(+:failed)
+    {
+        float* in = (float*)malloc((long)in_w * channels * sizeof(float));
+        float* out = (float*)malloc((long)out_w * channels * sizeof(float));
+        int ok = in && out;
+        failed += !ok;
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < src->height; y++) {
+            if (!ok) continue;
+            load_row_float(src, (long)y * in_w * channels, in, (long)in_w * channels);
+
+            for (int c = 0; c < channels; c++) {
+                #pragma omp simd
+                for (int x = 0; x < out_w; x++) {
+                    const int* idx = t->index + (size_t)x * taps;
+                    const float* w = t->weights + (size_t)(x % t->phases) * taps;
+                    float sum = 0.0f;
+                    for (int j = 0; j < taps; j++) sum += w[j] * in[idx[j] * channels + c];
+                    out[x * channels + c] = sum;
+                }
+            }
+
+            store_row_float(out, dst, (long)y * out_w * channels, (long)out_w * channels);
+        }
+
+        free(in);
+        free(out);
+    }
+    return !failed;
+}
+
+// Resample columns to a new height, vectorized across each output row; returns 0 if a
+// thread's row buffer cannot be allocated
+static int vertical_pass(Image* src, Image* dst, ResampleTable* t) {
+    int taps = t->taps;
+    long row_len = (long)src->width * src->channels;
+    int failed = 0;
+
+    #pragma omp parallel reduction(+:failed)
+    {
+        float* acc = (float*)malloc(row_len * sizeof(float));
+        failed += !acc;
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < t->out_len; y++) {
+            if (!acc) continue;
+            const int* idx = t->index + (size_t)y * taps;
+            const float* w = t->weights + (size_t)(y % t->phases) * taps;
+
+            memset(acc, 0, row_len * sizeof(float));
+            for (int j = 0; j < taps; j++) {
+                accumulate_row(acc, src, idx[j] * row_len, w[j], row_len);
+            }
+            store_row_float(acc, dst, y * row_len, row_len);
+        }
+
+        free(acc);
+    }
+    return !failed;
+}
+
+// Parse a resize filter name; returns -1 if unknown
+int parse_resize_filter(const char* name) {
+    if (strcmp(name, "lanczos3") == 0) return RESIZE_LANCZOS3;
+    if (strcmp(name, "bicubic") == 0) return RESIZE_BICUBIC;
+    if (strcmp(name, "area") == 0) return RESIZE_AREA;
+    return -1;
+}
+
+// Resize input to the dimensions of output with two separable passes.
+// blur_sigma (output pixels) folds an additional Gaussian blur into the taps.
+// Returns 0 (output not written) if the tables or buffers cannot be allocated.
+int resize_image(Image* input, Image* output, ResizeFilter filter, float blur_sigma, ConvConfig* config) {
+    int in_w = input->width;
+    int in_h = input->height;
+    int out_w = output->width;
+    int out_h = output->height;
+    int channels = input->channels;
+
+    ResampleTable tx, ty;
+    if (!build_table(&tx, in_w, out_w, filter, blur_sigma)) return 0;
+    if (!build_table(&ty, in_h, out_h, filter, blur_sigma)) {
+        free_table(&tx);
+        return 0;
+    }
+
+    omp_set_num_threads(config->num_threads);
+    PixelType tmp_type = config->half_intermediates ? PIXEL_F16 : PIXEL_F32;
+
+    // Run the pass that shrinks the data most first
+    long cost_h_first = (long)in_h * out_w * tx.taps + (long)out_h * out_w * ty.taps;
+    long cost_v_first = (long)out_h * in_w * ty.taps + (long)out_h * out_w * tx.taps;
+
+    int ok = 0;
+    if (cost_h_first <= cost_v_first) {
+        Image* tmp = create_image_typed(out_w, in_h, channels, tmp_type);
+        ok = tmp && horizontal_pass(input, tmp, &tx) && vertical_pass(tmp, output, &ty);
+        free_image(tmp);
+    } else {
+        Image* tmp = create_image_typed(in_w, out_h, channels, tmp_type);
+        ok = tmp && vertical_pass(input, tmp, &ty) && horizontal_pass(tmp, output, &tx);
+        free_image(tmp);
+    }
+    if (!ok) fprintf(stderr, "Failed to allocate resize buffers\n");
+
+    free_table(&tx);
+    free_table(&ty);
+    return ok;
+}
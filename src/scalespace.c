@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Taps covering +-3 sigma
+static int sigma_size(float sigma) {
+    return 2 * (int)ceilf(3.0f * sigma) + 1;
+}
+
+// Copy a level into the emission image (input type, native range)
+static void emit_gaussian(Image* level, Image* out) {
+    long row_len = (long)level->width * level->channels;
+
+    #pragma omp parallel
+    {
+        float* row = (float*)malloc(row_len * sizeof(float));
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < level->height; y++) {
+            load_row_float(level, y * row_len, row, row_len);
+            store_row_float(row, out, y * row_len, row_len);
+        }
+
+        free(row);
+    }
+}
+
+// out = upper - lower + offset, where offset is mid-range for integer types
+static void emit_dog(Image* lower, Image* upper, Image* out) {
+    long row_len = (long)upper->width * upper->channels;
+    float offset = out->type == PIXEL_U8 ? 128.0f : (out->type == PIXEL_U16 ? 32768.0f : 0.0f);
+
+    #pragma omp parallel
+    {
+        float* row = (float*)malloc(row_len * sizeof(float));
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < upper->height; y++) {
+            for (long i = 0; i < row_len; i++) row[i] = offset;
+            accumulate_row(row, upper, y * row_len, 1.0f, row_len);
+            accumulate_row(row, lower, y * row_len, -1.0f, row_len);
+            store_row_float(row, out, y * row_len, row_len);
+        }
+
+        free(row);
+    }
+}
+
+// Gaussian scale space with sigma_i = sigma0 * ratio^i. Level i is the previous level
+// blurred by sqrt(sigma_i^2 - sigma_{i-1}^2), so every blur after the first is small.
+// Levels stay in two float (or FP16) buffers; each Gaussian and each DoG is handed to
+// emit as soon as it exists, in the input's sample type (DoGs offset to mid-range).
+// Needs sigma0 > 0 and ratio > 1; returns 0 if a buffer or a level's taps cannot be
+// allocated.
+int build_scale_space(Image* input, int levels, float sigma0, float ratio, ConvConfig* config,
+                      ScaleSpaceEmit emit, void* user, ScaleSpaceStats* stats) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    PixelType level_type = config->half_intermediates ? PIXEL_F16 : PIXEL_F32;
+
+    Image* prev = create_image_typed(width, height, channels, level_type);
+    Image* cur = create_image_typed(width, height, channels, level_type);
+    Image* scratch = create_image_typed(width, height, channels, level_type);
+    Image* out = create_image_typed(width, height, channels, input->type);
+    if (!prev || !cur || !scratch || !out) {
+        free_image(prev);
+        free_image(cur);
+        free_image(scratch);
+        free_image(out);
+        return 0;
+    }
+
+    long incremental_taps = 0;
+    long independent_taps = 0;
+    double blur_time = 0.0;
+    float prev_sigma = 0.0f;
+    int ok = 1;
+
+    for (int i = 0; i < levels; i++) {
+        float sigma = sigma0 * powf(ratio, (float)i);
+        float step = sqrtf(sigma * sigma - prev_sigma * prev_sigma);
+        int size = sigma_size(step);
+        float* taps = create_gaussian_taps(size, step);
+        if (!taps) {
+            ok = 0;
+            break;
+        }
+
+        // Separable taps per pixel, versus blurring the input directly to sigma
+        incremental_taps += 2 * size;
+        independent_taps += 2 * sigma_size(sigma);
+
+        double start_time = get_time();
+        convolve_separable_scratch(i == 0 ? input : prev, cur, taps, size, config, scratch);
+        blur_time += get_time() - start_time;
+        free(taps);
+
+        emit_gaussian(cur, out);
+        emit(0, i, sigma, out, user);
+        if (i > 0) {
+            emit_dog(prev, cur, out);
+            emit(1, i - 1, prev_sigma, out, user);
+        }
+
+        Image* t = prev;
+        prev = cur;
+        cur = t;
+        prev_sigma = sigma;
+    }
+
+    if (stats) {
+        stats->blur_time = blur_time;
+        stats->incremental_taps = incremental_taps;
+        stats->independent_taps = independent_taps;
+    }
+
+    free_image(prev);
+    free_image(cur);
+    free_image(scratch);
+    free_image(out);
+    return ok;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Separable convolution: a horizontal pass into an intermediate image, then a vertical
+// pass into output. Borders are zero-padded like the direct engines, and integer outputs
+// are truncated like theirs. The sums are taken in a different order, so a result that
+// is within float rounding of an integer (flat regions) can land on the other side of
+// it: the output is within 1 of the direct engine.
+//
+// With config->half_intermediates the intermediate is stored as FP16. Half precision keeps
+// 11 significant bits, so each stored value carries a relative error of at most 2^-11.
+// For 8-bit data (|v| < 256) that is at most 0.0625 absolute. The vertical taps of a
+// normalized non-negative kernel sum to 1, so the error stays below 0.0625 and the
+// truncated output is still within 1 of the direct engine. For u16 and f32 data the
+// bound stays 2^-11 relative (up to 16 counts near 65535). Magnitudes above 65504
+// saturate, so those inputs should keep FP32 intermediates.
+void convolve_separable(Image* input, Image* output, const float* taps, int kernel_size, ConvConfig* config) {
+    Image* tmp = create_image_typed(input->width, input->height, input->channels,
+                                   config->half_intermediates ? PIXEL_F16 : PIXEL_F32);
+    if (!tmp) return;
+
+    convolve_separable_scratch(input, output, taps, kernel_size, config, tmp);
+    free_image(tmp);
+}
+
+// Same as convolve_separable with a caller-owned intermediate (same size as input),
+// so repeated calls share one buffer; its type selects FP32 or FP16 storage
+void convolve_separable_scratch(Image* input, Image* output, const float* taps, int kernel_size,
+                                ConvConfig* config, Image* tmp) {
+    convolve_separable_xy(input, output, taps, taps, kernel_size, config, tmp);
+}
+
+// Separable pass pair with different horizontal (row) and vertical (column) taps
+void convolve_separable_xy(Image* input, Image* output, const float* row_taps, const float* col_taps,
+                           int kernel_size, ConvConfig* config, Image* tmp) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    int half_kernel = kernel_size / 2;
+    int row_len = width * channels;
+    int padded_len = (width + 2 * half_kernel) * channels;
+
+    omp_set_num_threads(config->num_threads);
+
+    #pragma omp parallel
+    {
+        // Zero-padded input row and one output row of floats per thread
+        float* padded = (float*)calloc(padded_len, sizeof(float));
+        float* acc = (float*)malloc(row_len * sizeof(float));
+
+        // Horizontal pass, vectorized across the samples of each row
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; y++) {
+            load_row_float(input, (long)y * row_len, padded + half_kernel * channels, row_len);
+
+            memset(acc, 0, row_len * sizeof(float));
+            for (int k = 0; k < kernel_size; k++) {
+                float w = row_taps[k];
+                const float* src = padded + k * channels;
+                #pragma omp simd
+                for (int i = 0; i < row_len; i++) {
+                    acc[i] += w * src[i];
+                }
+            }
+            store_row_float(acc, tmp, (long)y * row_len, row_len);
+        }
+
+        // Vertical pass reads rows written by other threads
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; y++) {
+            memset(acc, 0, row_len * sizeof(float));
+            for (int k = 0; k < kernel_size; k++) {
+                int src_y = y + k - half_kernel;
+                if (src_y >= 0 && src_y < height) {
+                    accumulate_row(acc, tmp, (long)src_y * row_len, col_taps[k], row_len);
+                }
+            }
+            store_row_truncate(acc, output, (long)y * row_len, row_len);
+        }
+
+        free(padded);
+        free(acc);
+    }
+}
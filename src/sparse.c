@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Row-major tap order, so taps sharing a source row are applied back to back
+static int compare_taps(const void* a, const void* b) {
+    const SparseTap* ta = (const SparseTap*)a;
+    const SparseTap* tb = (const SparseTap*)b;
+    if (ta->dy != tb->dy) return ta->dy - tb->dy;
+    return ta->dx - tb->dx;
+}
+
+// Keep the non-zero taps of a dense kernel, with offsets scaled by dilation
+SparseKernel* create_sparse_kernel(float** kernel, int size, int dilation) {
+    SparseKernel* k = (SparseKernel*)malloc(sizeof(SparseKernel));
+    if (!k) return NULL;
+
+    k->taps = (SparseTap*)malloc((size_t)size * size * sizeof(SparseTap));
+    if (!k->taps) {
+        free(k);
+        return NULL;
+    }
+
+    int half = size / 2;
+    k->count = 0;
+    k->radius = 0;
+    k->dilation = dilation;
+
+    for (int ky = 0; ky < size; ky++) {
+        for (int kx = 0; kx < size; kx++) {
+            if (kernel[ky][kx] == 0.0f) continue;
+            SparseTap* t = &k->taps[k->count++];
+            t->dy = (ky - half) * dilation;
+            t->dx = (kx - half) * dilation;
+            t->w = kernel[ky][kx];
+            if (abs(t->dy) > k->radius) k->radius = abs(t->dy);
+            if (abs(t->dx) > k->radius) k->radius = abs(t->dx);
+        }
+    }
+
+    qsort(k->taps, k->count, sizeof(SparseTap), compare_taps);
+    return k;
+}
+
+void free_sparse_kernel(SparseKernel* k) {
+    if (k) {
+        free(k->taps);
+        free(k);
+    }
+}
+
+// Sparse convolution: each output row loads every distinct source row once into a
+// zero-padded float row and applies only that row's taps, so the cost is
+// O(non-zero taps) per pixel regardless of the kernel's extent or dilation. The taps are
+// added in the direct engine's row-major order and integer outputs are truncated like
+// its, so with dilation 1 the output is identical to the direct engine's. Returns 0 if
+// the per-thread rows cannot be allocated
+int convolve_sparse(Image* input, Image* output, SparseKernel* k, ConvConfig* config) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    int row_len = width * channels;
+    int pad = k->radius * channels;
+
+    omp_set_num_threads(config->num_threads);
+
+    int failed = 0;
+    #pragma omp parallel reduction(+:failed)
+    {
+        float* padded = (float*)calloc((size_t)row_len + 2 * pad, sizeof(float));
+        float* acc = (float*)malloc(row_len * sizeof(float));
+        int ok = padded && acc;
+        failed += !ok;
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; y++) {
+            if (!ok) continue;
+            memset(acc, 0, row_len * sizeof(float));
+
+            int t = 0;
+            while (t < k->count) {
+                int src_y = y + k->taps[t].dy;
+                int end = t;
+                while (end < k->count && k->taps[end].dy == k->taps[t].dy) end++;
+
+                // Rows outside the image are zero
+                if (src_y >= 0 && src_y < height) {
+                    load_row_float(input, (long)src_y * row_len, padded + pad, row_len);
+                    for (; t < end; t++) {
+                        float w = k->taps[t].w;
+                        const float* src = padded + pad + k->taps[t].dx * channels;
+                        #pragma omp simd
+                        for (int i = 0; i < row_len; i++) {
+                            acc[i] += w * src[i];
+                        }
+                    }
+                }
+                t = end;
+            }
+
+            store_row_truncate(acc, output, (long)y * row_len, row_len);
+        }
+
+        free(padded);
+        free(acc);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to allocate sparse convolution rows\n");
+        return 0;
+    }
+    return 1;
+}
+
+// out = a - b (+ mid-range offset for integer outputs), or acc += gain * (a - b).
+// Returns 0 if the per-thread rows cannot be allocated
+static int difference_planes(Image* a, Image* b, Image* out, float* recon, float gain) {
+    long row_len = (long)a->width * a->channels;
+    float offset = out->type == PIXEL_U8 ? 128.0f : (out->type == PIXEL_U16 ? 32768.0f : 0.0f);
+
+    int failed = 0;
+    #pragma omp parallel reduction(+:failed)
+    {
+        float* row = (float*)malloc(row_len * sizeof(float));
+        failed += !row;
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < a->height; y++) {
+            if (!row) continue;
+            for (long i = 0; i < row_len; i++) row[i] = 0.0f;
+            accumulate_row(row, a, y * row_len, 1.0f, row_len);
+            accumulate_row(row, b, y * row_len, -1.0f, row_len);
+
+            float* r = recon + y * row_len;
+            for (long i = 0; i < row_len; i++) {
+                r[i] += gain * row[i];
+                row[i] += offset;
+            }
+            store_row_float(row, out, y * row_len, row_len);
+        }
+
+        free(row);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to allocate wavelet difference rows\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Starlet (isotropic undecimated wavelet) transform. Smooth plane c_{j+1} is c_j convolved
+// with the 5x5 B3-spline kernel dilated by 2^j ("with holes"), so every scale costs the
+// same 25 taps. Detail planes w_j = c_j - c_{j+1} and the residual c_J are handed to emit;
+// output receives c_J + gain * sum(w_j), which is the input again for gain 1.
+int atrous_transform(Image* input, Image* output, int levels, float gain, ConvConfig* config,
+                     AtrousEmit emit, void* user, AtrousStats* stats) {
+    static const float b3[5] = {1.0f / 16, 4.0f / 16, 6.0f / 16, 4.0f / 16, 1.0f / 16};
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    long n = (long)width * height * channels;
+    long row_len = (long)width * channels;
+    PixelType level_type = config->half_intermediates ? PIXEL_F16 : PIXEL_F32;
+
+    float** kernel = create_kernel(5);
+    Image* prev = create_image_typed(width, height, channels, level_type);
+    Image* cur = create_image_typed(width, height, channels, level_type);
+    Image* plane = create_image_typed(width, height, channels, input->type);
+    float* recon = (float*)calloc(n, sizeof(float));
+    if (!kernel || !prev || !cur || !plane || !recon) {
+        free_kernel(kernel, 5);
+        free_image(prev);
+        free_image(cur);
+        free_image(plane);
+        free(recon);
+        return 0;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 5; j++) {
+            kernel[i][j] = b3[i] * b3[j];
+        }
+    }
+
+    double convolve_time = 0.0;
+    long sparse_taps = 0;
+    long dense_taps = 0;
+    int ok = 1;
+
+    for (int j = 0; j < levels && ok; j++) {
+        SparseKernel* k = create_sparse_kernel(kernel, 5, 1 << j);
+        if (!k) {
+            ok = 0;
+            break;
+        }
+
+        // A dense kernel spanning the same holes would have (4 * 2^j + 1)^2 taps
+        sparse_taps += k->count;
+        dense_taps += (long)(2 * k->radius + 1) * (2 * k->radius + 1);
+
+        double start_time = get_time();
+        ok = convolve_sparse(j == 0 ? input : prev, cur, k, config);
+        convolve_time += get_time() - start_time;
+        free_sparse_kernel(k);
+
+        ok = ok && difference_planes(j == 0 ? input : prev, cur, plane, recon, gain);
+        if (!ok) break;
+        if (emit) emit(j, plane, user);
+
+        Image* t = prev;
+        prev = cur;
+        cur = t;
+    }
+
+    if (ok) {
+        // Residual: add the coarsest smooth plane to the reconstruction
+        int failed = 0;
+        #pragma omp parallel reduction(+:failed)
+        {
+            float* row = (float*)malloc(row_len * sizeof(float));
+            failed += !row;
+
+            #pragma omp for schedule(static)
+            for (int y = 0; y < height; y++) {
+                if (!row) continue;
+                load_row_float(levels > 0 ? prev : input, y * row_len, row, row_len);
+                float* r = recon + y * row_len;
+                for (long i = 0; i < row_len; i++) r[i] += row[i];
+                store_row_float(row, plane, y * row_len, row_len);
+                store_row_float(r, output, y * row_len, row_len);
+            }
+
+            free(row);
+        }
+        if (failed) {
+            fprintf(stderr, "Failed to allocate wavelet residual rows\n");
+            ok = 0;
+        } else if (emit) {
+            emit(levels, plane, user);
+        }
+    }
+
+    if (stats) {
+        stats->convolve_time = convolve_time;
+        stats->sparse_taps = sparse_taps;
+        stats->dense_taps = dense_taps;
+    }
+
+    free_kernel(kernel, 5);
+    free_image(prev);
+    free_image(cur);
+    free_image(plane);
+    free(recon);
+    return ok;
+}
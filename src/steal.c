@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Chase-Lev deque of task indices, one per thread, on its own cache lines. All tasks are
+// placed before the run and nothing is pushed afterwards, so the array never wraps or
+// grows; only the owner's pop (bottom) and thieves' steals (top) race, via top's CAS.
+typedef struct {
+    _Alignas(64) atomic_long top;
+    _Alignas(64) atomic_long bottom;
+    int* items;
+} TaskDeque;
+
+// Owner: take the task at the bottom (the next one in its seeded order)
+static int deque_pop(TaskDeque* q, int* task) {
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+    if (t > b) {
+        // Empty
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+
+    *task = q->items[b];
+    if (t == b) {
+        // Last task: race the thieves for it
+        int won = atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1, memory_order_seq_cst,
+                                                          memory_order_relaxed);
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        return won;
+    }
+    return 1;
+}
+
+// Thief: take the task at the top (the far end of the owner's range).
+// Returns 1 on success, 0 if empty, -1 if another thread won the race.
+static int deque_steal(TaskDeque* q, int* task) {
+    long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+
+    if (t >= b) return 0;
+
+    int x = q->items[t];
+    if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return -1;
+    }
+    *task = x;
+    return 1;
+}
+
+// Run fn(task, thread, arg) for tasks 0..num_tasks-1 on config->num_threads threads.
+// Thread i's deque is seeded with the i-th contiguous range of tasks, in order, so
+// without stealing this is schedule(static) with one chunk per thread. A thread that
+// runs dry steals from the far end of its neighbors' ranges, nearest neighbor first,
+// which keeps the stolen work away from what the owner touches next. Nothing is pushed
+// after seeding, so a thread that finds every deque empty is done. Returns 0 if the
+// deques cannot be allocated, in which case no task has run.
+int steal_for(int num_tasks, ConvConfig* config, StealTaskFn fn, void* arg, StealStats* stats) {
+    long steals = 0;
+    TaskDeque* deques = NULL;
+    int* items = (int*)malloc((num_tasks > 0 ? num_tasks : 1) * sizeof(int));
+    if (!items) {
+        fprintf(stderr, "Failed to allocate work-stealing tasks\n");
+        return 0;
+    }
+
+    omp_set_num_threads(config->num_threads);
+
+    #pragma omp parallel reduction(+:steals)
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        affinity_bind();
+
+        #pragma omp single
+        {
+            deques = (TaskDeque*)aligned_alloc(64, nthreads * sizeof(TaskDeque));
+            if (deques) {
+                for (int i = 0; i < nthreads; i++) {
+                    long begin = (long)num_tasks * i / nthreads;
+                    long end = (long)num_tasks * (i + 1) / nthreads;
+
+                    // Reverse order: the owner pops from the bottom, so it sees begin first
+                    for (long k = begin; k < end; k++) items[begin + end - 1 - k] = (int)k;
+                    deques[i].items = items + begin;
+                    atomic_init(&deques[i].top, 0);
+                    atomic_init(&deques[i].bottom, end - begin);
+                }
+            }
+        }
+
+        if (deques) {
+            TaskDeque* own = &deques[tid];
+            int task;
+            for (;;) {
+                int got = deque_pop(own, &task);
+
+                for (int v = 1; !got && v < nthreads; v++) {
+                    int r;
+                    while ((r = deque_steal(&deques[(tid + v) % nthreads], &task)) < 0) {
+                    }
+                    if (r > 0) {
+                        got = 1;
+                        steals++;
+                    }
+                }
+
+                if (!got) break;
+                fn(task, tid, arg);
+            }
+        }
+    }
+
+    int ok = deques != NULL;
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate work-stealing deques\n");
+    }
+    if (stats) {
+        stats->tasks = num_tasks;
+        stats->steals = steals;
+    }
+
+    free(deques);
+    free(items);
+    return ok;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Ring of the last `frames` frames, preallocated at the sequence's size and type.
+// weights[i] applies to the frame i steps older than the newest one.
+FrameRing* create_frame_ring(int frames, int width, int height, int channels, PixelType type,
+                             const float* weights) {
+    FrameRing* ring = (FrameRing*)malloc(sizeof(FrameRing));
+    if (!ring) return NULL;
+
+    ring->capacity = frames;
+    ring->count = 0;
+    ring->head = -1;
+    ring->weights = (float*)malloc(frames * sizeof(float));
+    ring->frame = (Image**)calloc(frames, sizeof(Image*));
+    if (!ring->weights || !ring->frame) {
+        free_frame_ring(ring);
+        return NULL;
+    }
+    memcpy(ring->weights, weights, frames * sizeof(float));
+
+    for (int i = 0; i < frames; i++) {
+        ring->frame[i] = create_image_typed(width, height, channels, type);
+        if (!ring->frame[i]) {
+            free_frame_ring(ring);
+            return NULL;
+        }
+    }
+    return ring;
+}
+
+void free_frame_ring(FrameRing* ring) {
+    if (ring) {
+        if (ring->frame) {
+            for (int i = 0; i < ring->capacity; i++) {
+                free_image(ring->frame[i]);
+            }
+        }
+        free(ring->frame);
+        free(ring->weights);
+        free(ring);
+    }
+}
+
+// Copy a decoded frame into the oldest slot; it becomes the newest frame
+void frame_ring_push(FrameRing* ring, Image* frame) {
+    ring->head = (ring->head + 1) % ring->capacity;
+    if (ring->count < ring->capacity) ring->count++;
+
+    Image* slot = ring->frame[ring->head];
+    memcpy(slot->data, frame->data,
+           (size_t)slot->width * slot->height * slot->channels * pixel_size(slot->type));
+}
+
+// Spatio-temporal filter of the newest frame: the weighted sum of the frames in the
+// ring (weights renormalized over the frames seen so far) convolved with the separable
+// spatial taps. Convolution is linear, so the temporal sum is formed first, one source
+// row at a time, and fed straight into the horizontal pass; each thread keeps the last
+// kernel_size filtered rows of its band in a ring for the vertical pass. One pass reads
+// each frame row once per band (plus the halo rows at band edges).
+void filter_spatiotemporal(FrameRing* ring, Image* output, const float* taps, int kernel_size,
+                           ConvConfig* config) {
+    int width = output->width;
+    int height = output->height;
+    int channels = output->channels;
+    int half_kernel = kernel_size / 2;
+    long row_len = (long)width * channels;
+    long padded_len = (width + 2L * half_kernel) * channels;
+
+    // Frame order newest first, with normalized weights
+    Image** frames = (Image**)malloc(ring->capacity * sizeof(Image*));
+    float* weights = (float*)malloc(ring->capacity * sizeof(float));
+    if (!frames || !weights) {
+        free(frames);
+        free(weights);
+        return;
+    }
+    float total = 0.0f;
+    for (int i = 0; i < ring->count; i++) total += ring->weights[i];
+    for (int i = 0; i < ring->count; i++) {
+        frames[i] = ring->frame[(ring->head - i + ring->capacity) % ring->capacity];
+        weights[i] = ring->weights[i] / total;
+    }
+
+    omp_set_num_threads(config->num_threads);
+
+    #pragma omp parallel
+    {
+        float* padded = (float*)calloc(padded_len, sizeof(float));
+        float* rows = (float*)malloc((size_t)kernel_size * row_len * sizeof(float));
+        float* acc = (float*)malloc(row_len * sizeof(float));
+
+        // Contiguous band of rows per thread, so the row ring carries over between rows
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        int y0 = (int)((long)height * tid / nthreads);
+        int y1 = (int)((long)height * (tid + 1) / nthreads);
+        int next = y0 - half_kernel < 0 ? 0 : y0 - half_kernel;
+
+        for (int y = y0; y < y1; y++) {
+            for (; next <= y + half_kernel && next < height; next++) {
+                float* center = padded + half_kernel * channels;
+                memset(center, 0, row_len * sizeof(float));
+                for (int i = 0; i < ring->count; i++) {
+                    accumulate_row(center, frames[i], next * row_len, weights[i], row_len);
+                }
+
+                float* dst = rows + (next % kernel_size) * row_len;
+                memset(dst, 0, row_len * sizeof(float));
+                for (int k = 0; k < kernel_size; k++) {
+                    float w = taps[k];
+                    const float* s = padded + k * channels;
+                    #pragma omp simd
+                    for (long i = 0; i < row_len; i++) dst[i] += w * s[i];
+                }
+            }
+
+            memset(acc, 0, row_len * sizeof(float));
+            for (int k = 0; k < kernel_size; k++) {
+                int src_y = y + k - half_kernel;
+                if (src_y < 0 || src_y >= height) continue;
+                float w = taps[k];
+                const float* s = rows + (src_y % kernel_size) * row_len;
+                #pragma omp simd
+                for (long i = 0; i < row_len; i++) acc[i] += w * s[i];
+            }
+            store_row_float(acc, output, y * row_len, row_len);
+        }
+
+        free(padded);
+        free(rows);
+        free(acc);
+    }
+
+    free(frames);
+    free(weights);
+}
@@ -0,0 +1,174 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <omp.h>
+#include "convolution.h"
+
+// Empty parallel regions timed per team size
+#define FORK_JOIN_REPS 50
+
+// Multiply-adds in the single-thread calibration run
+#define CALIBRATION_WORK (4L * 1024 * 1024)
+
+// CPUs allowed by the cgroup CPU quota (v2 cpu.max, else v1 cfs quota/period), rounded
+// up; 0 when there is no quota
+static int cgroup_cpu_limit(void) {
+    long quota = -1;
+    long period = 0;
+
+    FILE* f = fopen("/sys/fs/cgroup/cpu.max", "r");
+    if (f) {
+        char max[32];
+        if (fscanf(f, "%31s %ld", max, &period) == 2 && strcmp(max, "max") != 0) quota = atol(max);
+        fclose(f);
+    } else {
+        f = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r");
+        if (f) {
+            if (fscanf(f, "%ld", &quota) != 1) quota = -1;
+            fclose(f);
+        }
+        f = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r");
+        if (f) {
+            if (fscanf(f, "%ld", &period) != 1) period = 0;
+            fclose(f);
+        }
+    }
+
+    if (quota <= 0 || period <= 0) return 0;
+    return (int)((quota + period - 1) / period);
+}
+
+// CPUs this process can actually use: its affinity mask, capped by the cgroup quota.
+// *quota receives the quota in CPUs (0 if none).
+int available_cpus(int* quota) {
+    cpu_set_t allowed;
+    int cpus = omp_get_num_procs();
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) cpus = CPU_COUNT(&allowed);
+
+    int limit = cgroup_cpu_limit();
+    if (limit > 0 && limit < cpus) cpus = limit;
+    if (quota) *quota = limit;
+    return cpus > 0 ? cpus : 1;
+}
+
+// Written by the timed regions so they are not optimized away
+static volatile int fork_join_sink;
+
+// Average cost of forking and joining a team of `threads` that shares out a trivial loop
+static double fork_join_cost(int threads) {
+    omp_set_num_threads(threads);
+
+    // The first region creates the threads; it is not timed
+    #pragma omp parallel
+    {
+        fork_join_sink = 1;
+    }
+
+    double start = omp_get_wtime();
+    for (int r = 0; r < FORK_JOIN_REPS; r++) {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < threads; i++) {
+            fork_join_sink = i;
+        }
+    }
+    return (omp_get_wtime() - start) / FORK_JOIN_REPS;
+}
+
+// Kernel rows applied over `rows` output rows with zero padding (edge rows skip taps)
+static long vertical_taps(int rows, int kernel_size) {
+    int r = kernel_size / 2;
+    long taps = 0;
+    for (int y = 0; y < rows; y++) {
+        int top = y - r < 0 ? 0 : y - r;
+        int bottom = y + r > rows - 1 ? rows - 1 : y + r;
+        taps += bottom - top + 1;
+    }
+    return taps;
+}
+
+// Pick the team size for one run of the direct engine (-t auto).
+//
+// The model is T(t) = ceil(units / t) * unit_time + fork_join(t): the work is split
+// into units (rows, or tiles when config->tile_size is set) of equal cost, the team
+// finishes when its busiest thread does, and forking the team costs fork_join(t).
+// unit_time comes from timing the engine on one thread over a centered band of the
+// input with about CALIBRATION_WORK multiply-adds (work = pixels x taps x channels),
+// scaled by the kernel rows actually applied, since the band's edge rows skip taps;
+// fork_join(t) is measured for each candidate t. Candidates grow by about 1.5x up to
+// cpus, the available_cpus() count, so the team never oversubscribes the affinity mask
+// or the cgroup quota. The caller takes that count before -A pins the main thread to a
+// single CPU, which would leave a mask of one. A larger team is taken only if it
+// predicts at least 2% less time.
+int choose_thread_count(Image* input, float** kernel, int kernel_size, const ConvConfig* config, int cpus,
+                        AutoThreadStats* stats) {
+    int width = input->width;
+    int height = input->height;
+    if (cpus < 1) cpus = 1;
+    long row_work = (long)width * input->channels * kernel_size * kernel_size;
+
+    // Calibrate on one thread
+    int rows = (int)(CALIBRATION_WORK / (row_work > 0 ? row_work : 1));
+    if (rows < kernel_size) rows = kernel_size;
+    if (rows > height) rows = height;
+    long row_bytes = (long)width * input->channels * pixel_size(input->type);
+    Image* sample = create_image_typed(width, rows, input->channels, input->type);
+    Image* out = create_image_typed(width, rows, input->channels, input->type);
+    if (!sample || !out) {
+        fprintf(stderr, "Failed to allocate thread calibration buffers\n");
+        free_image(sample);
+        free_image(out);
+        return cpus;
+    }
+    memcpy(sample->data, input->data + (long)((height - rows) / 2) * row_bytes, rows * row_bytes);
+
+    ConvConfig one = *config;
+    one.num_threads = 1;
+    one.weights = NULL;
+    double sample_time = 0.0;
+    for (int rep = 0; rep < 2; rep++) {
+        double start = get_time();
+        convolve_direct(sample, out, kernel, kernel_size, 0, NULL, &one);
+        double elapsed = get_time() - start;
+        if (rep == 0 || elapsed < sample_time) sample_time = elapsed;
+    }
+    free_image(sample);
+    free_image(out);
+
+    double work_time = sample_time * vertical_taps(height, kernel_size) / vertical_taps(rows, kernel_size);
+    long units = height;
+    if (config->tile_size > 0) {
+        int tile_h = config->tile_size;
+        int tile_w = config->tile_width > 0 ? config->tile_width : tile_h;
+        units = (long)((width + tile_w - 1) / tile_w) * ((height + tile_h - 1) / tile_h);
+    }
+    double unit_time = work_time / units;
+
+    // Predict each candidate
+    int best = 1;
+    double best_time = 0.0;
+    double best_overhead = 0.0;
+    for (int t = 1; ; t = t * 3 / 2 > t ? t * 3 / 2 : t + 1) {
+        if (t > cpus) t = cpus;
+        double overhead = fork_join_cost(t);
+        double predicted = (double)((units + t - 1) / t) * unit_time + overhead;
+        if (t == 1 || predicted < 0.98 * best_time) {
+            best = t;
+            best_time = predicted;
+            best_overhead = overhead;
+        }
+        if (t == cpus) break;
+    }
+
+    if (stats) {
+        stats->cpus = cpus;
+        stats->quota = cgroup_cpu_limit();
+        stats->work = row_work * height;
+        stats->work_time = work_time;
+        stats->fork_join = best_overhead;
+        stats->predicted = best_time;
+    }
+    return best;
+}
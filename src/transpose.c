@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "convolution.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_SSE_TRANSPOSE 1
+#endif
+
+// Pixels per side of a cache block: a 32x32 block of up to 16-byte pixels is 16 KB per
+// side, so source and destination blocks share L1 and every touched line is used fully
+#define TRANSPOSE_BLOCK 32
+
+// Bytes per cache line; padded transposed rows are a whole, odd number of lines
+#define TRANSPOSE_LINE 64
+
+// Copy one pixel of a compile-time size, so the copy compiles to plain moves
+#define COPY_PIXEL(BYTES)                                                                      \
+    for (int y = y0; y < y1; y++) {                                                            \
+        for (int x = x0; x < x1; x++) {                                                        \
+            memcpy(d + (long)x * d_stride + (long)y * (BYTES), s + (long)y * s_stride + (long)x * (BYTES), (BYTES)); \
+        }                                                                                      \
+    }
+
+// Scalar transpose of pixels [x0, x1) x [y0, y1); strides are in bytes
+static void transpose_block_scalar(const uint8_t* s, long s_stride, uint8_t* d, long d_stride, int bytes,
+                                   int x0, int y0, int x1, int y1) {
+    switch (bytes) {
+        case 1: COPY_PIXEL(1); break;
+        case 2: COPY_PIXEL(2); break;
+        case 3: COPY_PIXEL(3); break;
+        case 4: COPY_PIXEL(4); break;
+        case 6: COPY_PIXEL(6); break;
+        case 8: COPY_PIXEL(8); break;
+        case 12: COPY_PIXEL(12); break;
+        case 16: COPY_PIXEL(16); break;
+        default: COPY_PIXEL(bytes); break;
+    }
+}
+
+#ifdef HAVE_SSE_TRANSPOSE
+// 4-byte pixels (RGBA8, 2-channel u16, 1-channel f32): 4x4 pixel tiles are transposed
+// in registers, one 16-byte load and store per row of the tile
+static void transpose_block_sse4x4(const uint8_t* s, long s_stride, uint8_t* d, long d_stride,
+                                   int x0, int y0, int x1, int y1) {
+    int xv = x0 + ((x1 - x0) & ~3);
+    int yv = y0 + ((y1 - y0) & ~3);
+    for (int y = y0; y < yv; y += 4) {
+        for (int x = x0; x < xv; x += 4) {
+            const uint8_t* src = s + (long)y * s_stride + (long)x * 4;
+            __m128 r0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(src)));
+            __m128 r1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(src + s_stride)));
+            __m128 r2 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(src + 2 * s_stride)));
+            __m128 r3 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(src + 3 * s_stride)));
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            uint8_t* dst = d + (long)x * d_stride + (long)y * 4;
+            _mm_storeu_si128((__m128i*)(dst), _mm_castps_si128(r0));
+            _mm_storeu_si128((__m128i*)(dst + d_stride), _mm_castps_si128(r1));
+            _mm_storeu_si128((__m128i*)(dst + 2 * d_stride), _mm_castps_si128(r2));
+            _mm_storeu_si128((__m128i*)(dst + 3 * d_stride), _mm_castps_si128(r3));
+        }
+    }
+    // Ragged right and bottom edges
+    if (xv < x1) transpose_block_scalar(s, s_stride, d, d_stride, 4, xv, y0, x1, y1);
+    if (yv < y1) transpose_block_scalar(s, s_stride, d, d_stride, 4, x0, yv, xv, y1);
+}
+
+// 1-byte pixels (grayscale u8): 8x8 tiles, interleaving bytes, then pairs, then quads of
+// the 8-byte rows, so each output row is one 8-byte store
+static void transpose_block_sse8x8(const uint8_t* s, long s_stride, uint8_t* d, long d_stride,
+                                   int x0, int y0, int x1, int y1) {
+    int xv = x0 + ((x1 - x0) & ~7);
+    int yv = y0 + ((y1 - y0) & ~7);
+    for (int y = y0; y < yv; y += 8) {
+        for (int x = x0; x < xv; x += 8) {
+            const uint8_t* src = s + (long)y * s_stride + x;
+            __m128i r[8];
+            for (int i = 0; i < 8; i++) r[i] = _mm_loadl_epi64((const __m128i*)(src + i * s_stride));
+            __m128i b0 = _mm_unpacklo_epi8(r[0], r[1]);
+            __m128i b1 = _mm_unpacklo_epi8(r[2], r[3]);
+            __m128i b2 = _mm_unpacklo_epi8(r[4], r[5]);
+            __m128i b3 = _mm_unpacklo_epi8(r[6], r[7]);
+            __m128i w0 = _mm_unpacklo_epi16(b0, b1);
+            __m128i w1 = _mm_unpackhi_epi16(b0, b1);
+            __m128i w2 = _mm_unpacklo_epi16(b2, b3);
+            __m128i w3 = _mm_unpackhi_epi16(b2, b3);
+            __m128i q[4] = {_mm_unpacklo_epi32(w0, w2), _mm_unpackhi_epi32(w0, w2),
+                            _mm_unpacklo_epi32(w1, w3), _mm_unpackhi_epi32(w1, w3)};
+            uint8_t* dst = d + (long)x * d_stride + y;
+            for (int i = 0; i < 4; i++) {
+                _mm_storel_epi64((__m128i*)(dst + (2 * i) * d_stride), q[i]);
+                _mm_storel_epi64((__m128i*)(dst + (2 * i + 1) * d_stride), _mm_srli_si128(q[i], 8));
+            }
+        }
+    }
+    if (xv < x1) transpose_block_scalar(s, s_stride, d, d_stride, 1, xv, y0, x1, y1);
+    if (yv < y1) transpose_block_scalar(s, s_stride, d, d_stride, 1, x0, yv, xv, y1);
+}
+
+static int has_ssse3(void) {
+    static int cached = -1;
+    if (cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("ssse3");
+    }
+    return cached;
+}
+
+// 3-byte pixels (RGB u8, the default image format): each 12-byte row of a 4x4 tile is
+// widened to four 4-byte lanes with a byte shuffle, the tile is transposed like the
+// 4-byte case, and the lanes are packed back to 12 bytes. Rows are loaded and stored as
+// 8 + 4 bytes so nothing past the last pixel is touched.
+__attribute__((target("ssse3")))
+static void transpose_block_ssse3_rgb(const uint8_t* s, long s_stride, uint8_t* d, long d_stride,
+                                      int x0, int y0, int x1, int y1) {
+    const __m128i widen = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int xv = x0 + ((x1 - x0) & ~3);
+    int yv = y0 + ((y1 - y0) & ~3);
+    for (int y = y0; y < yv; y += 4) {
+        for (int x = x0; x < xv; x += 4) {
+            __m128 r[4];
+            for (int i = 0; i < 4; i++) {
+                const uint8_t* src = s + (long)(y + i) * s_stride + (long)x * 3;
+                int tail;
+                memcpy(&tail, src + 8, 4);
+                __m128i row = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)src), _mm_cvtsi32_si128(tail));
+                r[i] = _mm_castsi128_ps(_mm_shuffle_epi8(row, widen));
+            }
+            _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+            for (int i = 0; i < 4; i++) {
+                uint8_t* dst = d + (long)(x + i) * d_stride + (long)y * 3;
+                __m128i row = _mm_shuffle_epi8(_mm_castps_si128(r[i]), pack);
+                int tail = _mm_cvtsi128_si32(_mm_srli_si128(row, 8));
+                _mm_storel_epi64((__m128i*)dst, row);
+                memcpy(dst + 8, &tail, 4);
+            }
+        }
+    }
+    if (xv < x1) transpose_block_scalar(s, s_stride, d, d_stride, 3, xv, y0, x1, y1);
+    if (yv < y1) transpose_block_scalar(s, s_stride, d, d_stride, 3, x0, yv, xv, y1);
+}
+#endif
+
+// Row stride for a transposed buffer whose rows hold row_bytes: rounded up to a whole
+// number of cache lines, made odd. Column convolution reads and writes the same offset in
+// rows a stride apart; with an exact stride of a power of two (2048 RGB pixels is 6 KB,
+// 2048 u8 samples 2 KB) those rows map to a few L1 sets, and loads falsely depend on
+// stores 4 KB apart. An odd number of lines walks through all the sets instead.
+long transpose_row_stride(long row_bytes) {
+    long lines = (row_bytes + TRANSPOSE_LINE - 1) / TRANSPOSE_LINE;
+    if (lines % 2 == 0) lines++;
+    return lines * TRANSPOSE_LINE;
+}
+
+// Transpose width x height pixels of `bytes` each from src to dst: pixel (x, y) of src
+// becomes pixel (y, x) of dst. Strides are the bytes between rows, so either side may
+// be padded. Pixels move as units, so channels stay interleaved. The image is cut into
+// TRANSPOSE_BLOCK blocks that threads transpose independently.
+void transpose_pixels(const uint8_t* src, long src_stride, uint8_t* dst, long dst_stride, int width, int height,
+                      int bytes, int num_threads) {
+    int blocks_x = (width + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    int blocks_y = (height + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+#ifdef HAVE_SSE_TRANSPOSE
+    int rgb_shuffle = bytes == 3 && has_ssse3();
+#endif
+
+    omp_set_num_threads(num_threads);
+
+    #pragma omp parallel
+    {
+        affinity_bind();
+        #pragma omp for schedule(static) collapse(2)
+        for (int by = 0; by < blocks_y; by++) {
+            for (int bx = 0; bx < blocks_x; bx++) {
+                int x0 = bx * TRANSPOSE_BLOCK;
+                int y0 = by * TRANSPOSE_BLOCK;
+                int x1 = x0 + TRANSPOSE_BLOCK < width ? x0 + TRANSPOSE_BLOCK : width;
+                int y1 = y0 + TRANSPOSE_BLOCK < height ? y0 + TRANSPOSE_BLOCK : height;
+#ifdef HAVE_SSE_TRANSPOSE
+                if (bytes == 4) {
+                    transpose_block_sse4x4(src, src_stride, dst, dst_stride, x0, y0, x1, y1);
+                    continue;
+                } else if (bytes == 1) {
+                    transpose_block_sse8x8(src, src_stride, dst, dst_stride, x0, y0, x1, y1);
+                    continue;
+                } else if (bytes == 3 && rgb_shuffle) {
+                    transpose_block_ssse3_rgb(src, src_stride, dst, dst_stride, x0, y0, x1, y1);
+                    continue;
+                }
+#endif
+                transpose_block_scalar(src, src_stride, dst, dst_stride, bytes, x0, y0, x1, y1);
+            }
+        }
+    }
+}
+
+// dst = transpose of src: dst is src->height pixels wide and src->width pixels tall, with
+// the same channels and type. Both images are packed.
+int transpose_image(const Image* src, Image* dst, int num_threads) {
+    if (dst->width != src->height || dst->height != src->width || dst->channels != src->channels ||
+        dst->type != src->type) {
+        fprintf(stderr, "Transpose destination has the wrong shape\n");
+        return 0;
+    }
+
+    int bytes = src->channels * pixel_size(src->type);
+    transpose_pixels(src->data, (long)src->width * bytes, dst->data, (long)dst->width * bytes, src->width,
+                     src->height, bytes, num_threads);
+    return 1;
+}
@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+#define VARYING_DEFAULT_TILE 64
+#define VARYING_MAX_LEVELS 64
+
+// One output tile, tagged with the quantized kernels it needs
+typedef struct {
+    int x0, y0, x1, y1;
+    int level;          // kernel level at the tile center, used for grouping
+    uint64_t mask;      // bit q set if any pixel in the tile uses level q
+} VaryingTile;
+
+// Cache of prepared Gaussian taps, one slot per quantized sigma level
+KernelCache* create_kernel_cache(int levels, float max_sigma) {
+    KernelCache* cache = (KernelCache*)malloc(sizeof(KernelCache));
+    if (!cache) return NULL;
+
+    cache->levels = levels;
+    cache->max_sigma = max_sigma;
+    cache->kernel = (PreparedKernel*)calloc(levels, sizeof(PreparedKernel));
+    if (!cache->kernel) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+// Prepared taps for a level, built on first use
+PreparedKernel* kernel_cache_get(KernelCache* cache, int level) {
+    PreparedKernel* k = &cache->kernel[level];
+    if (!k->taps) {
+        k->sigma = cache->levels > 1 ? cache->max_sigma * level / (cache->levels - 1) : 0.0f;
+        k->radius = (int)ceilf(3.0f * k->sigma);
+        int size = 2 * k->radius + 1;
+        if (k->radius > 0) {
+            k->taps = create_gaussian_taps(size, k->sigma);
+        } else {
+            // Identity kernel
+            k->taps = (float*)malloc(sizeof(float));
+            if (k->taps) k->taps[0] = 1.0f;
+        }
+    }
+    return k;
+}
+
+void free_kernel_cache(KernelCache* cache) {
+    if (cache) {
+        for (int i = 0; i < cache->levels; i++) {
+            free(cache->kernel[i].taps);
+        }
+        free(cache->kernel);
+        free(cache);
+    }
+}
+
+// Synthetic vignette map: no blur in the center, max at the corners
+Image* create_vignette_map(int width, int height) {
+    Image* map = create_image(width, height, 1);
+    if (!map) return NULL;
+
+    float cx = 0.5f * (width - 1);
+    float cy = 0.5f * (height - 1);
+    float max_r = sqrtf(cx * cx + cy * cy);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float r = sqrtf((x - cx) * (x - cx) + (y - cy) * (y - cy)) / max_r;
+            map->data[(long)y * width + x] = (uint8_t)(255.0f * r * r);
+        }
+    }
+    return map;
+}
+
+// Quantized kernel level for every pixel; the map is sampled nearest-neighbor,
+// so a coarse map acts as a per-tile parameter grid
+static uint8_t* quantize_map(Image* map, int width, int height, int levels) {
+    uint8_t* level = (uint8_t*)malloc((size_t)width * height);
+    if (!level) return NULL;
+
+    static const float range[] = {255.0f, 65535.0f, 1.0f, 1.0f};
+    float scale = (levels - 1) / range[map->type];
+    float* row = (float*)malloc((size_t)map->width * map->channels * sizeof(float));
+    if (!row) {
+        free(level);
+        return NULL;
+    }
+
+    for (int y = 0; y < height; y++) {
+        int my = (int)((long)y * map->height / height);
+        load_row_float(map, (long)my * map->width * map->channels, row, (long)map->width * map->channels);
+        for (int x = 0; x < width; x++) {
+            int mx = (int)((long)x * map->width / width);
+            int q = (int)lroundf(row[mx * map->channels] * scale);
+            level[(long)y * width + x] = (uint8_t)(q < 0 ? 0 : (q >= levels ? levels - 1 : q));
+        }
+    }
+
+    free(row);
+    return level;
+}
+
+// Blur one tile with one prepared kernel, writing pixels whose level matches
+// (or every pixel when level_map is NULL) into the tile's float output
+static void blur_tile(Image* input, const VaryingTile* t, PreparedKernel* k, const uint8_t* level_map,
+                      int level, float* region, float* hbuf, float* acc, float* out) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    int r = k->radius;
+    int tw = t->x1 - t->x0;
+    int th = t->y1 - t->y0;
+    int rw = (tw + 2 * r) * channels;
+    int out_len = tw * channels;
+
+    // Load the tile plus halo, zero outside the image
+    for (int j = 0; j < th + 2 * r; j++) {
+        float* dst = region + (long)j * rw;
+        int y = t->y0 - r + j;
+        memset(dst, 0, rw * sizeof(float));
+        if (y < 0 || y >= height) continue;
+        int xs = t->x0 - r < 0 ? 0 : t->x0 - r;
+        int xe = t->x1 + r > width ? width : t->x1 + r;
+        load_row_float(input, ((long)y * width + xs) * channels,
+                       dst + (xs - (t->x0 - r)) * channels, (long)(xe - xs) * channels);
+    }
+
+    // Horizontal pass over all halo rows
+    for (int j = 0; j < th + 2 * r; j++) {
+        const float* src = region + (long)j * rw;
+        float* dst = hbuf + (long)j * out_len;
+        memset(dst, 0, out_len * sizeof(float));
+        for (int m = 0; m <= 2 * r; m++) {
+            float w = k->taps[m];
+            const float* s = src + m * channels;
+            #pragma omp simd
+            for (int i = 0; i < out_len; i++) dst[i] += w * s[i];
+        }
+    }
+
+    // Vertical pass; rows outside the image were zero in region and hence in hbuf
+    for (int j = 0; j < th; j++) {
+        memset(acc, 0, out_len * sizeof(float));
+        for (int m = 0; m <= 2 * r; m++) {
+            float w = k->taps[m];
+            const float* s = hbuf + (long)(j + m) * out_len;
+            #pragma omp simd
+            for (int i = 0; i < out_len; i++) acc[i] += w * s[i];
+        }
+
+        float* o = out + (long)j * out_len;
+        if (!level_map) {
+            memcpy(o, acc, out_len * sizeof(float));
+        } else {
+            const uint8_t* lv = level_map + (long)(t->y0 + j) * width + t->x0;
+            for (int x = 0; x < tw; x++) {
+                if (lv[x] == level) {
+                    memcpy(o + x * channels, acc + x * channels, channels * sizeof(float));
+                }
+            }
+        }
+    }
+}
+
+// Per-thread buffers for blur_tile
+typedef struct {
+    float* region;
+    float* hbuf;
+    float* acc;
+    float* out;
+} VaryingScratch;
+
+// Shared state of one convolve_varying run
+typedef struct {
+    Image* input;
+    Image* output;
+    KernelCache* cache;
+    const uint8_t* level_map;
+    const VaryingTile* sorted;
+    int max_radius;
+    int span;                // tile + 2 * max_radius
+    int tile;
+    VaryingScratch* scratch; // per thread, -s steal only
+    long* passes;            // per thread, -s steal only
+} VaryingJob;
+
+static void alloc_varying_scratch(VaryingScratch* s, const VaryingJob* job, int channels) {
+    s->region = (float*)malloc((size_t)job->span * job->span * channels * sizeof(float));
+    s->hbuf = (float*)malloc((size_t)job->span * job->tile * channels * sizeof(float));
+    s->acc = (float*)malloc((size_t)job->tile * channels * sizeof(float));
+    s->out = (float*)malloc((size_t)job->tile * job->tile * channels * sizeof(float));
+}
+
+static void free_varying_scratch(VaryingScratch* s) {
+    free(s->region);
+    free(s->hbuf);
+    free(s->acc);
+    free(s->out);
+}
+
+// Blur one tile with every kernel it needs and store it; returns the passes run
+static long varying_tile(const VaryingJob* job, const VaryingTile* t, VaryingScratch* s) {
+    int channels = job->input->channels;
+    long row_len = (long)job->input->width * channels;
+    int single = (t->mask & (t->mask - 1)) == 0;
+    int tw = t->x1 - t->x0;
+    long passes = 0;
+
+    // The center level first (it usually covers the whole tile), then any others
+    uint64_t todo = t->mask;
+    int q = t->level;
+    while (todo) {
+        blur_tile(job->input, t, &job->cache->kernel[q], single ? NULL : job->level_map, q,
+                  s->region, s->hbuf, s->acc, s->out);
+        todo &= ~(1ull << q);
+        passes++;
+        if (todo) q = __builtin_ctzll(todo);
+    }
+
+    for (int y = t->y0; y < t->y1; y++) {
+        store_row_float(s->out + (long)(y - t->y0) * tw * channels, job->output,
+                        y * row_len + (long)t->x0 * channels, (long)tw * channels);
+    }
+    return passes;
+}
+
+static void varying_tile_task(int task, int thread, void* arg) {
+    VaryingJob* job = (VaryingJob*)arg;
+    job->passes[thread] += varying_tile(job, &job->sorted[task], &job->scratch[thread]);
+}
+
+// Spatially varying Gaussian blur. sigma_map (channel 0) maps [0, type max] to [0, max_sigma],
+// quantized to `levels` kernels. Tiles are grouped by kernel and scheduled dynamically
+// (or on work-stealing deques with -s steal).
+void convolve_varying(Image* input, Image* output, Image* sigma_map, float max_sigma, int levels,
+                      ConvConfig* config, VaryingStats* stats) {
+    int width = input->width;
+    int height = input->height;
+    int channels = input->channels;
+    int tile = config->tile_size > 0 ? config->tile_size : VARYING_DEFAULT_TILE;
+
+    if (levels < 2) levels = 2;
+    if (levels > VARYING_MAX_LEVELS) levels = VARYING_MAX_LEVELS;
+
+    uint8_t* level_map = quantize_map(sigma_map, width, height, levels);
+    KernelCache* cache = create_kernel_cache(levels, max_sigma);
+    int tiles_x = (width + tile - 1) / tile;
+    int tiles_y = (height + tile - 1) / tile;
+    int num_tiles = tiles_x * tiles_y;
+    VaryingTile* tiles = (VaryingTile*)malloc(num_tiles * sizeof(VaryingTile));
+    VaryingTile* sorted = (VaryingTile*)malloc(num_tiles * sizeof(VaryingTile));
+    if (!level_map || !cache || !tiles || !sorted) {
+        fprintf(stderr, "Failed to allocate spatially varying engine state\n");
+        free(level_map);
+        free_kernel_cache(cache);
+        free(tiles);
+        free(sorted);
+        return;
+    }
+
+    omp_set_num_threads(config->num_threads);
+
+    // Tag each tile with the levels it contains
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_tiles; i++) {
+        VaryingTile* t = &tiles[i];
+        t->x0 = (i % tiles_x) * tile;
+        t->y0 = (i / tiles_x) * tile;
+        t->x1 = t->x0 + tile < width ? t->x0 + tile : width;
+        t->y1 = t->y0 + tile < height ? t->y0 + tile : height;
+        t->mask = 0;
+        for (int y = t->y0; y < t->y1; y++) {
+            for (int x = t->x0; x < t->x1; x++) {
+                t->mask |= 1ull << level_map[(long)y * width + x];
+            }
+        }
+        t->level = level_map[(long)((t->y0 + t->y1) / 2) * width + (t->x0 + t->x1) / 2];
+    }
+
+    // Group tiles by kernel (counting sort on the center level) and prepare used kernels
+    int count[VARYING_MAX_LEVELS + 1] = {0};
+    uint64_t used = 0;
+    for (int i = 0; i < num_tiles; i++) {
+        count[tiles[i].level + 1]++;
+        used |= tiles[i].mask;
+    }
+    for (int q = 0; q < levels; q++) count[q + 1] += count[q];
+    for (int i = 0; i < num_tiles; i++) sorted[count[tiles[i].level]++] = tiles[i];
+
+    int max_radius = 0;
+    int kernels_used = 0;
+    for (int q = 0; q < levels; q++) {
+        if (used & (1ull << q)) {
+            PreparedKernel* k = kernel_cache_get(cache, q);
+            if (k->radius > max_radius) max_radius = k->radius;
+            kernels_used++;
+        }
+    }
+
+    VaryingJob job = {input, output, cache, level_map, sorted, max_radius,
+                      tile + 2 * max_radius, tile, NULL, NULL};
+    long passes = 0;
+    long steals = 0;
+
+    if (strcmp(config->schedule_type, "steal") == 0) {
+        // Kernel-sorted tiles on work-stealing deques: each thread keeps a contiguous run
+        // of same-kernel tiles and only the tail of a neighbor's run migrates
+        StealStats steal_stats = {0, 0};
+        job.scratch = (VaryingScratch*)calloc(config->num_threads, sizeof(VaryingScratch));
+        job.passes = (long*)calloc(config->num_threads, sizeof(long));
+        if (job.scratch && job.passes) {
+            for (int i = 0; i < config->num_threads; i++) alloc_varying_scratch(&job.scratch[i], &job, channels);
+            steal_for(num_tiles, config, varying_tile_task, &job, &steal_stats);
+            for (int i = 0; i < config->num_threads; i++) {
+                free_varying_scratch(&job.scratch[i]);
+                passes += job.passes[i];
+            }
+            steals = steal_stats.steals;
+        } else {
+            fprintf(stderr, "Failed to allocate work-stealing scratch\n");
+        }
+        free(job.scratch);
+        free(job.passes);
+    } else {
+        #pragma omp parallel reduction(+:passes)
+        {
+            VaryingScratch scratch;
+            alloc_varying_scratch(&scratch, &job, channels);
+
+            #pragma omp for schedule(dynamic, config->chunk_size)
+            for (int i = 0; i < num_tiles; i++) {
+                passes += varying_tile(&job, &sorted[i], &scratch);
+            }
+
+            free_varying_scratch(&scratch);
+        }
+    }
+
+    if (stats) {
+        stats->tiles = num_tiles;
+        stats->kernels_used = kernels_used;
+        stats->tile_passes = passes;
+        stats->steals = steals;
+    }
+
+    free(level_map);
+    free_kernel_cache(cache);
+    free(tiles);
+    free(sorted);
+}
@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "convolution.h"
+
+#define VOLUME_MAX_PATH 1024
+
+Volume* create_volume(int width, int height, int depth, int channels, PixelType type) {
+    Volume* vol = (Volume*)malloc(sizeof(Volume));
+    if (!vol) return NULL;
+
+    vol->width = width;
+    vol->height = height;
+    vol->depth = depth;
+    vol->channels = channels;
+    vol->type = type;
+    vol->slice = (Image**)calloc(depth, sizeof(Image*));
+    if (!vol->slice) {
+        free(vol);
+        return NULL;
+    }
+
+    for (int z = 0; z < depth; z++) {
+        vol->slice[z] = create_image_typed(width, height, channels, type);
+        if (!vol->slice[z]) {
+            free_volume(vol);
+            return NULL;
+        }
+    }
+    return vol;
+}
+
+void free_volume(Volume* vol) {
+    if (vol) {
+        for (int z = 0; z < vol->depth; z++) {
+            free_image(vol->slice[z]);
+        }
+        free(vol->slice);
+        free(vol);
+    }
+}
+
+// Read a text file listing one image path per line (blank lines and lines starting
+// with '#' are skipped). Relative paths are resolved against the list file's directory.
+// Returns NULL if the file cannot be read, a line is longer than VOLUME_MAX_PATH - 1
+// characters, memory runs out or no path is listed; nothing is returned partially.
+char** read_path_list(const char* list_file, int* count) {
+    FILE* f = fopen(list_file, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open list file: %s\n", list_file);
+        return NULL;
+    }
+
+    const char* slash = strrchr(list_file, '/');
+    int dir_len = slash ? (int)(slash - list_file) + 1 : 0;
+
+    char** paths = NULL;
+    int n = 0;
+    int capacity = 0;
+    int line_no = 0;
+    char line[VOLUME_MAX_PATH];
+
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+
+        // A full buffer without a newline is a path that did not fit, unless the line
+        // ends right there
+        size_t len = strlen(line);
+        int next = len == sizeof(line) - 1 && line[len - 1] != '\n' ? fgetc(f) : EOF;
+        if (next != EOF && next != '\n' && next != '\r') {
+            fprintf(stderr, "Line %d of %s is too long (limit %d characters)\n", line_no, list_file,
+                    VOLUME_MAX_PATH - 1);
+            free_path_list(paths, n);
+            fclose(f);
+            return NULL;
+        }
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        if (n == capacity) {
+            capacity = capacity ? 2 * capacity : 16;
+            char** grown = (char**)realloc(paths, capacity * sizeof(char*));
+            if (!grown) {
+                fprintf(stderr, "Failed to allocate memory for list file: %s\n", list_file);
+                free_path_list(paths, n);
+                fclose(f);
+                return NULL;
+            }
+            paths = grown;
+        }
+
+        int prefix = line[0] == '/' ? 0 : dir_len;
+        paths[n] = (char*)malloc(prefix + strlen(line) + 1);
+        if (!paths[n]) {
+            fprintf(stderr, "Failed to allocate memory for list file: %s\n", list_file);
+            free_path_list(paths, n);
+            fclose(f);
+            return NULL;
+        }
+        sprintf(paths[n], "%.*s%s", prefix, list_file, line);
+        n++;
+    }
+    fclose(f);
+
+    if (n == 0) {
+        fprintf(stderr, "List file is empty: %s\n", list_file);
+        free(paths);
+        return NULL;
+    }
+
+    *count = n;
+    return paths;
+}
+
+void free_path_list(char** paths, int count) {
+    if (paths) {
+        for (int i = 0; i < count; i++) {
+            free(paths[i]);
+        }
+        free(paths);
+    }
+}
+
+// Load a volume from a slice list (see read_path_list). All slices must match the
+// first one's size and channels; their samples are converted to its type.
+Volume* load_volume(const char* list_file) {
+    int depth = 0;
+    char** paths = read_path_list(list_file, &depth);
+    if (!paths) return NULL;
+
+    Image** slices = (Image**)calloc(depth, sizeof(Image*));
+    int ok = slices != NULL;
+
+    for (int z = 0; ok && z < depth; z++) {
+        Image* img = load_image(paths[z]);
+        if (!img) {
+            ok = 0;
+            break;
+        }
+
+        if (z > 0) {
+            if (img->width != slices[0]->width || img->height != slices[0]->height ||
+                img->channels != slices[0]->channels) {
+                fprintf(stderr, "Slice %s does not match the first slice's size\n", paths[z]);
+                free_image(img);
+                ok = 0;
+                break;
+            }
+            if (img->type != slices[0]->type) {
+                Image* converted = convert_image(img, slices[0]->type);
+                free_image(img);
+                img = converted;
+                if (!img) {
+                    ok = 0;
+                    break;
+                }
+            }
+        }
+        slices[z] = img;
+    }
+    free_path_list(paths, depth);
+
+    Volume* vol = ok ? (Volume*)malloc(sizeof(Volume)) : NULL;
+    if (!vol) {
+        if (slices) {
+            for (int z = 0; z < depth; z++) free_image(slices[z]);
+        }
+        free(slices);
+        return NULL;
+    }
+
+    vol->width = slices[0]->width;
+    vol->height = slices[0]->height;
+    vol->depth = depth;
+    vol->channels = slices[0]->channels;
+    vol->type = slices[0]->type;
+    vol->slice = slices;
+    return vol;
+}
+
+// Save every slice as <stem>_zNNN<ext>
+int save_volume(const char* output_file, Volume* vol) {
+    const char* ext = strrchr(output_file, '.');
+    int stem = ext ? (int)(ext - output_file) : (int)strlen(output_file);
+    char path[VOLUME_MAX_PATH];
+
+    for (int z = 0; z < vol->depth; z++) {
+        snprintf(path, sizeof(path), "%.*s_z%03d%s", stem, output_file, z, ext ? ext : "");
+        if (!save_image(path, vol->slice[z])) return 0;
+    }
+    return 1;
+}
+
+// Separable 3-D convolution with the same taps along x, y and z, zero-padded.
+//
+// XY pass: slices are distributed over threads as slabs. Each thread keeps the last
+// kernel_size horizontally blurred rows in a ring, so a slice is read once and the
+// vertical pass runs out of that ring into the intermediate volume.
+//
+// Z pass: output slices are grouped into z-blocks sized so that the block's float
+// accumulator rows fit in L2. For each row of a block, every source
+// slice row is loaded once and added to all the output rows it reaches, instead of
+// re-reading kernel_size rows per output row. Returns 0 (output not written) if the
+// intermediate volume or a thread's scratch rows cannot be allocated.
+int convolve_volume_separable(Volume* input, Volume* output, const float* taps, int kernel_size,
+                               ConvConfig* config) {
+    int width = input->width;
+    int height = input->height;
+    int depth = input->depth;
+    int channels = input->channels;
+    int half_kernel = kernel_size / 2;
+    long row_len = (long)width * channels;
+    long padded_len = (width + 2L * half_kernel) * channels;
+
+    Volume* mid = create_volume(width, height, depth, channels,
+                                config->half_intermediates ? PIXEL_F16 : PIXEL_F32);
+    if (!mid) {
+        fprintf(stderr, "Failed to allocate volume intermediate\n");
+        return 0;
+    }
+
+    int block = (int)(cache_size(2) / (row_len * sizeof(float))) - 1;
+    if (block < 1) block = 1;
+    if (block > depth) block = depth;
+    int num_blocks = (depth + block - 1) / block;
+
+    int failed = 0;
+
+    omp_set_num_threads(config->num_threads);
+
+    #pragma omp parallel reduction(+:failed)
+    {
+        float* padded = (float*)calloc(padded_len, sizeof(float));
+        float* ring = (float*)malloc((size_t)kernel_size * row_len * sizeof(float));
+        float* acc = (float*)malloc((size_t)block * row_len * sizeof(float));
+        float* src = (float*)malloc(row_len * sizeof(float));
+        int ok = padded && ring && acc && src;
+        failed += !ok;
+
+        #pragma omp for schedule(static)
+        for (int z = 0; z < depth; z++) {
+            if (!ok) continue;
+            Image* in = input->slice[z];
+            int next = 0;
+            for (int y = 0; y < height; y++) {
+                // Horizontal pass for source rows up to y + half_kernel
+                for (; next <= y + half_kernel && next < height; next++) {
+                    float* dst = ring + (next % kernel_size) * row_len;
+                    load_row_float(in, next * row_len, padded + half_kernel * channels, row_len);
+                    memset(dst, 0, row_len * sizeof(float));
+                    for (int k = 0; k < kernel_size; k++) {
+                        float w = taps[k];
+                        const float* s = padded + k * channels;
+                        #pragma omp simd
+                        for (long i = 0; i < row_len; i++) dst[i] += w * s[i];
+                    }
+                }
+
+                memset(src, 0, row_len * sizeof(float));
+                for (int k = 0; k < kernel_size; k++) {
+                    int src_y = y + k - half_kernel;
+                    if (src_y < 0 || src_y >= height) continue;
+                    float w = taps[k];
+                    const float* s = ring + (src_y % kernel_size) * row_len;
+                    #pragma omp simd
+                    for (long i = 0; i < row_len; i++) src[i] += w * s[i];
+                }
+                store_row_float(src, mid->slice[z], y * row_len, row_len);
+            }
+        }
+
+        #pragma omp for collapse(2) schedule(static)
+        for (int b = 0; b < num_blocks; b++) {
+            for (int y = 0; y < height; y++) {
+                if (!ok) continue;
+                int z0 = b * block;
+                int z1 = z0 + block < depth ? z0 + block : depth;
+                int s0 = z0 - half_kernel < 0 ? 0 : z0 - half_kernel;
+                int s1 = z1 + half_kernel > depth ? depth : z1 + half_kernel;
+
+                memset(acc, 0, (size_t)(z1 - z0) * row_len * sizeof(float));
+                for (int s = s0; s < s1; s++) {
+                    load_row_float(mid->slice[s], y * row_len, src, row_len);
+
+                    // Output slices z with |z - s| <= half_kernel
+                    int za = s - half_kernel < z0 ? z0 : s - half_kernel;
+                    int zb = s + half_kernel + 1 > z1 ? z1 : s + half_kernel + 1;
+                    for (int z = za; z < zb; z++) {
+                        float w = taps[s - z + half_kernel];
+                        float* a = acc + (z - z0) * row_len;
+                        #pragma omp simd
+                        for (long i = 0; i < row_len; i++) a[i] += w * src[i];
+                    }
+                }
+
+                for (int z = z0; z < z1; z++) {
+                    store_row_float(acc + (z - z0) * row_len, output->slice[z], y * row_len, row_len);
+                }
+            }
+        }
+
+        free(padded);
+        free(ring);
+        free(acc);
+        free(src);
+    }
+
+    free_volume(mid);
+    if (failed) {
+        fprintf(stderr, "Failed to allocate volume scratch rows\n");
+        return 0;
+    }
+    return 1;
+}